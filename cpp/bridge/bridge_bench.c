@@ -0,0 +1,461 @@
+// Bridge latency harness: drives scan_bridge_* with scripted command mixes
+// and reports latency percentiles and throughput, end-to-end and per trace stage.
+//
+// Build and run (the engine opens "data/..." relative to the working directory):
+//   cd cpp/scan/src && make bridge-bench && cd .. && src/bridge-bench [rounds [depth]]
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "scan_bridge.h"
+
+// Replies the harness waits for, with their arrival times
+
+enum { REPLY_PONG, REPLY_DONE, REPLY_READY, REPLY_SIZE };
+
+#define REPLY_MAX (1 << 20)
+#define COMMAND_MAX (1 << 20)
+#define TRACE_CHUNK 4096
+
+static pthread_mutex_t g_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_cond = PTHREAD_COND_INITIALIZER;
+
+static long long* g_reply_time[REPLY_SIZE];
+static int g_reply_count[REPLY_SIZE];
+
+static long long* g_send_time; // by command id, ids follow the send order from 1
+static int g_sent = 0;
+
+// Per-command trace stages, filled from scan_bridge_trace_read()
+
+typedef struct {
+    long long push;
+    long long pop;
+    long long dispatch;
+    long long search_start;
+    long long search_first_info;
+    long long search_end;
+    long long send; // last message sent while handling the command
+    long long handled;
+} Stages;
+
+static Stages* g_stages; // by command id
+
+// Opening line for "pos" commands (prefixes of it)
+
+static const char* Moves[] = {
+    "34-30", "20-25", "32-28", "25x34x30", "39x30x34", "17-22", "28x17x22", "12x21x17", "44-39", "7-12",
+};
+
+static const int Moves_Size = (int)(sizeof(Moves) / sizeof(Moves[0]));
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void on_message(const char* message, void* context) {
+    (void)context;
+
+    int kind = -1;
+
+    if (strncmp(message, "pong", 4) == 0) {
+        kind = REPLY_PONG;
+    } else if (strncmp(message, "done", 4) == 0) {
+        kind = REPLY_DONE;
+    } else if (strncmp(message, "ready", 5) == 0) {
+        kind = REPLY_READY;
+    } else if (strncmp(message, "error", 5) == 0) {
+        fprintf(stderr, "engine: %s\n", message);
+    }
+
+    if (kind < 0) {
+        return;
+    }
+
+    long long time = now_ns();
+
+    pthread_mutex_lock(&g_mutex);
+
+    if (g_reply_count[kind] < REPLY_MAX) {
+        g_reply_time[kind][g_reply_count[kind]++] = time;
+    }
+
+    pthread_cond_broadcast(&g_cond);
+    pthread_mutex_unlock(&g_mutex);
+}
+
+static int send_command(const char* command) { // returns the command id
+    if (g_sent + 1 >= COMMAND_MAX) {
+        fprintf(stderr, "too many commands\n");
+        exit(EXIT_FAILURE);
+    }
+
+    int id = ++g_sent;
+    g_send_time[id] = now_ns();
+
+    if (scan_bridge_send_command(command) != SCAN_SUCCESS) {
+        fprintf(stderr, "send failed: %s (%s)\n", command, scan_bridge_get_last_error());
+        exit(EXIT_FAILURE);
+    }
+
+    return id;
+}
+
+static int reply_count(int kind) {
+    pthread_mutex_lock(&g_mutex);
+    int count = g_reply_count[kind];
+    pthread_mutex_unlock(&g_mutex);
+    return count;
+}
+
+static void wait_replies(int kind, int count, int timeout_seconds) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout_seconds;
+
+    pthread_mutex_lock(&g_mutex);
+
+    while (g_reply_count[kind] < count) {
+        if (pthread_cond_timedwait(&g_cond, &g_mutex, &deadline) != 0) {
+            pthread_mutex_unlock(&g_mutex);
+            fprintf(stderr, "timeout waiting for replies\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    pthread_mutex_unlock(&g_mutex);
+}
+
+static void collect_trace(void) {
+    ScanTraceEvent events[TRACE_CHUNK];
+    int n;
+
+    while ((n = scan_bridge_trace_read(events, TRACE_CHUNK)) > 0) {
+        for (int i = 0; i < n; i++) {
+            const ScanTraceEvent* event = &events[i];
+
+            if (event->command == 0 || event->command >= COMMAND_MAX) {
+                continue;
+            }
+
+            Stages* stages = &g_stages[event->command];
+            const char* point = event->point;
+
+            if (strcmp(point, "push") == 0) {
+                stages->push = event->time_ns;
+            } else if (strcmp(point, "pop") == 0) {
+                stages->pop = event->time_ns;
+            } else if (strcmp(point, "dispatch") == 0) {
+                stages->dispatch = event->time_ns;
+            } else if (strcmp(point, "search-start") == 0) {
+                stages->search_start = event->time_ns;
+            } else if (strcmp(point, "search-first-info") == 0) {
+                stages->search_first_info = event->time_ns;
+            } else if (strcmp(point, "search-end") == 0) {
+                stages->search_end = event->time_ns;
+            } else if (strcmp(point, "send") == 0) {
+                stages->send = event->time_ns;
+            } else if (strcmp(point, "handled") == 0) {
+                stages->handled = event->time_ns;
+            }
+        }
+    }
+}
+
+// Statistics
+
+static int compare_ll(const void* a, const void* b) {
+    long long x = *(const long long*)a;
+    long long y = *(const long long*)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(const long long* sorted, int n, double p) {
+    int i = (int)(p * (double)(n - 1) + 0.5);
+    return (double)sorted[i] / 1000.0; // microseconds
+}
+
+static void report(const char* name, long long* values, int n) {
+    if (n == 0) {
+        printf("  %-18s no samples\n", name);
+        return;
+    }
+
+    qsort(values, (size_t)n, sizeof(long long), compare_ll);
+
+    printf("  %-18s n=%-6d p50=%10.1f  p90=%10.1f  p99=%10.1f  max=%10.1f us\n", name, n,
+           percentile(values, n, 0.50), percentile(values, n, 0.90), percentile(values, n, 0.99),
+           percentile(values, n, 1.00));
+}
+
+static void report_throughput(int commands, long long begin, long long end) {
+    double seconds = (double)(end - begin) / 1E9;
+    printf("  %-18s %.0f commands/s (%d in %.3f s)\n", "throughput", (double)commands / (seconds > 0.0 ? seconds : 1E-9),
+           commands, seconds);
+}
+
+// Stage differences for the commands first, first + step, ... last that have both points
+
+enum { STAGE_QUEUE, STAGE_DISPATCH, STAGE_HANDLE, STAGE_FIRST_INFO, STAGE_SEARCH, STAGE_REPLY };
+
+static void report_stage(const char* name, int stage, int first, int last, int step) {
+    int size = (last - first) / step + 1;
+    long long* values = malloc(sizeof(long long) * (size_t)size);
+    int n = 0;
+
+    for (int id = first; id <= last; id += step) {
+        const Stages* s = &g_stages[id];
+        long long begin = 0;
+        long long end = 0;
+
+        switch (stage) {
+        case STAGE_QUEUE:      begin = s->push;         end = s->pop;               break;
+        case STAGE_DISPATCH:   begin = s->pop;          end = s->dispatch;          break;
+        case STAGE_HANDLE:     begin = s->dispatch;     end = s->handled;           break;
+        case STAGE_FIRST_INFO: begin = s->search_start; end = s->search_first_info; break;
+        case STAGE_SEARCH:     begin = s->search_start; end = s->search_end;        break;
+        case STAGE_REPLY:      begin = s->search_end;   end = s->send;              break;
+        }
+
+        if (begin != 0 && end != 0) {
+            values[n++] = end - begin;
+        }
+    }
+
+    report(name, values, n);
+    free(values);
+}
+
+static void pos_command(char* buffer, size_t size, int round) {
+    int moves = round % (Moves_Size + 1);
+
+    snprintf(buffer, size, "pos start");
+
+    if (moves == 0) {
+        return;
+    }
+
+    strncat(buffer, " moves=\"", size - strlen(buffer) - 1);
+
+    for (int i = 0; i < moves; i++) {
+        if (i != 0) {
+            strncat(buffer, " ", size - strlen(buffer) - 1);
+        }
+        strncat(buffer, Moves[i], size - strlen(buffer) - 1);
+    }
+
+    strncat(buffer, "\"", size - strlen(buffer) - 1);
+}
+
+// Scenarios
+
+static void scenario_ping(int rounds) { // burst of pings, matched to pongs in order
+    printf("ping burst\n");
+
+    int base = reply_count(REPLY_PONG);
+    int first = g_sent + 1;
+
+    for (int i = 0; i < rounds; i++) {
+        send_command("ping");
+    }
+
+    wait_replies(REPLY_PONG, base + rounds, 60);
+    collect_trace();
+
+    long long* values = malloc(sizeof(long long) * (size_t)rounds);
+
+    for (int i = 0; i < rounds; i++) {
+        values[i] = g_reply_time[REPLY_PONG][base + i] - g_send_time[first + i];
+    }
+
+    report("end-to-end", values, rounds);
+    report_stage("queue", STAGE_QUEUE, first, first + rounds - 1, 1);
+    report_stage("dispatch", STAGE_DISPATCH, first, first + rounds - 1, 1);
+    report_stage("handle", STAGE_HANDLE, first, first + rounds - 1, 1);
+    report_throughput(rounds, g_send_time[first], g_reply_time[REPLY_PONG][base + rounds - 1]);
+
+    free(values);
+}
+
+static void scenario_pos(int rounds) { // burst of positions, then one ping as a barrier
+    printf("pos burst\n");
+
+    int base = reply_count(REPLY_PONG);
+    int first = g_sent + 1;
+    char command[256];
+
+    for (int i = 0; i < rounds; i++) {
+        pos_command(command, sizeof(command), i);
+        send_command(command);
+    }
+
+    send_command("ping");
+
+    wait_replies(REPLY_PONG, base + 1, 60);
+    collect_trace();
+
+    report_stage("queue", STAGE_QUEUE, first, first + rounds - 1, 1);
+    report_stage("dispatch", STAGE_DISPATCH, first, first + rounds - 1, 1);
+    report_stage("handle", STAGE_HANDLE, first, first + rounds - 1, 1);
+    report_throughput(rounds, g_send_time[first], g_reply_time[REPLY_PONG][base]);
+}
+
+static void scenario_go(int rounds, int depth) { // new-game + pos + level + go, one search at a time
+    printf("go depth=%d\n", depth);
+
+    long long* values = malloc(sizeof(long long) * (size_t)rounds);
+    int* ids = malloc(sizeof(int) * (size_t)rounds);
+    char command[256];
+
+    long long begin = now_ns();
+
+    for (int i = 0; i < rounds; i++) {
+        int base = reply_count(REPLY_DONE);
+
+        send_command("new-game"); // cold search, the positions repeat
+        pos_command(command, sizeof(command), i);
+        send_command(command);
+
+        snprintf(command, sizeof(command), "level depth=%d", depth);
+        send_command(command);
+
+        ids[i] = send_command("go think");
+
+        wait_replies(REPLY_DONE, base + 1, 600);
+        values[i] = g_reply_time[REPLY_DONE][base] - g_send_time[ids[i]];
+    }
+
+    long long end = now_ns();
+    collect_trace();
+
+    report("end-to-end", values, rounds);
+
+    // stages of the "go" commands only, 4 commands per round
+
+    report_stage("queue", STAGE_QUEUE, ids[0], ids[rounds - 1], 4);
+    report_stage("first info", STAGE_FIRST_INFO, ids[0], ids[rounds - 1], 4);
+    report_stage("search", STAGE_SEARCH, ids[0], ids[rounds - 1], 4);
+    report_stage("search end -> send", STAGE_REPLY, ids[0], ids[rounds - 1], 4);
+
+    report_throughput(rounds * 4, begin, end);
+
+    free(ids);
+    free(values);
+}
+
+static void scenario_stop(int rounds, double move_time) { // go, then stop right away: how long until "done"?
+    printf("go + stop (move-time=%.3f)\n", move_time);
+
+    long long* values = malloc(sizeof(long long) * (size_t)rounds);
+    char command[256];
+
+    for (int i = 0; i < rounds; i++) {
+        int base = reply_count(REPLY_DONE);
+
+        pos_command(command, sizeof(command), i);
+        send_command(command);
+
+        snprintf(command, sizeof(command), "level move-time=%.3f", move_time);
+        send_command(command);
+
+        send_command("go think");
+        int stop = send_command("stop");
+
+        wait_replies(REPLY_DONE, base + 1, 600);
+        values[i] = g_reply_time[REPLY_DONE][base] - g_send_time[stop];
+    }
+
+    collect_trace();
+
+    report("stop -> done", values, rounds);
+
+    free(values);
+}
+
+static void scenario_ping_during_go(int rounds, int depth) { // head-of-line blocking behind a search
+    printf("ping during go depth=%d\n", depth);
+
+    long long* values = malloc(sizeof(long long) * (size_t)rounds);
+    char command[256];
+
+    for (int i = 0; i < rounds; i++) {
+        int base_pong = reply_count(REPLY_PONG);
+        int base_done = reply_count(REPLY_DONE);
+
+        send_command("new-game");
+        pos_command(command, sizeof(command), i);
+        send_command(command);
+
+        snprintf(command, sizeof(command), "level depth=%d", depth);
+        send_command(command);
+
+        send_command("go think");
+        int ping = send_command("ping");
+
+        wait_replies(REPLY_PONG, base_pong + 1, 600);
+        wait_replies(REPLY_DONE, base_done + 1, 600);
+
+        values[i] = g_reply_time[REPLY_PONG][base_pong] - g_send_time[ping];
+    }
+
+    collect_trace();
+
+    report("ping -> pong", values, rounds);
+
+    free(values);
+}
+
+int main(int argc, char* argv[]) {
+    int rounds = (argc > 1) ? atoi(argv[1]) : 1000;
+    int depth = (argc > 2) ? atoi(argv[2]) : 10;
+
+    if (rounds < 1 || depth < 1) {
+        fprintf(stderr, "usage: %s [rounds [depth]]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    int search_rounds = (rounds / 50 > 5) ? rounds / 50 : 5;
+
+    for (int kind = 0; kind < REPLY_SIZE; kind++) {
+        g_reply_time[kind] = calloc(REPLY_MAX, sizeof(long long));
+    }
+
+    g_send_time = calloc(COMMAND_MAX, sizeof(long long));
+    g_stages = calloc(COMMAND_MAX, sizeof(Stages));
+
+    // Same sequence as the app: init, callback, start, then the hub commands
+
+    if (scan_bridge_init() != SCAN_SUCCESS) {
+        fprintf(stderr, "init failed: %s\n", scan_bridge_get_last_error());
+        return EXIT_FAILURE;
+    }
+
+    scan_bridge_set_callback(on_message, NULL);
+    scan_bridge_trace_enable(true);
+
+    if (scan_bridge_start() != SCAN_SUCCESS) {
+        fprintf(stderr, "start failed: %s\n", scan_bridge_get_last_error());
+        return EXIT_FAILURE;
+    }
+
+    send_command("set-param name=book value=false"); // measure searches, not book hits
+    send_command("init");
+
+    wait_replies(REPLY_READY, 1, 120);
+    collect_trace();
+
+    scenario_ping(rounds);
+    scenario_pos(rounds);
+    scenario_go(search_rounds, depth);
+    scenario_stop(search_rounds, 0.1);
+    scenario_ping_during_go(search_rounds, depth);
+
+    scan_bridge_shutdown();
+
+    return EXIT_SUCCESS;
+}
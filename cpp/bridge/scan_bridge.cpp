@@ -24,10 +24,12 @@
 #include "../scan/src/hash.hpp"
 #include "../scan/src/hub.hpp"
 #include "../scan/src/libmy.hpp"
+#include "../scan/src/logger.hpp"
 #include "../scan/src/move.hpp"
 #include "../scan/src/pos.hpp"
 #include "../scan/src/search.hpp"
 #include "../scan/src/sort.hpp"
+#include "../scan/src/startup.hpp"
 #include "../scan/src/thread.hpp"
 #include "../scan/src/tt.hpp"
 #include "../scan/src/util.hpp"
@@ -35,7 +37,9 @@
 
 #include <sstream>
 #include <chrono>
+#include <deque>
 #include <algorithm>
+#include <exception>
 #include <iostream>
 
 namespace ScanBridge {
@@ -55,20 +59,36 @@ private:
     std::mutex callbackMutex_;
     
     // Command queue (thread-safe)
-    std::queue<std::string> commandQueue_;
+    struct QueuedCommand {
+        std::string line;
+        unsigned long long id; // for tracing
+    };
+    
+    std::queue<QueuedCommand> commandQueue_;
     std::mutex queueMutex_;
     std::condition_variable queueCondition_;
+    std::atomic<unsigned long long> nextCommandId_;
+    unsigned long long currentCommand_; // engine thread only
     
     // Engine state
     Game engineGame_;
+    Search_Input level_; // set by "level", reset after each "go"
     std::atomic<bool> engineInitialized_;
     
+    // Latency tracing
+    static const std::size_t Trace_Size = 1 << 16;
+    
+    std::atomic<bool> traceEnabled_;
+    std::deque<ScanTraceEvent> traceEvents_;
+    std::mutex traceMutex_;
+    
     // Message buffer for output
     std::queue<std::string> outputQueue_;
     std::mutex outputMutex_;
     
 public:
-    Impl() : status_(SCAN_STATUS_STOPPED), shouldStop_(false), engineInitialized_(false) {}
+    Impl() : status_(SCAN_STATUS_STOPPED), shouldStop_(false), nextCommandId_(1), currentCommand_(0),
+             engineInitialized_(false), traceEnabled_(false) {}
     
     ~Impl() {
         shutdown();
@@ -83,6 +103,7 @@ public:
             setStatus(SCAN_STATUS_INITIALIZING);
             
             // Initialize Scan engine components
+            logger::init();
             bit::init();
             hash::init();
             pos::init();
@@ -147,8 +168,11 @@ public:
         }
         
         try {
+            unsigned long long id = nextCommandId_.fetch_add(1);
+            trace(id, "push");
+            
             std::lock_guard<std::mutex> lock(queueMutex_);
-            commandQueue_.push(command);
+            commandQueue_.push({command, id});
             queueCondition_.notify_one();
             return SCAN_SUCCESS;
         } catch (...) {
@@ -199,6 +223,23 @@ public:
         
         return status_.load() == SCAN_STATUS_READY;
     }
+    
+    void traceEnable(bool enable) {
+        traceEnabled_.store(enable);
+    }
+    
+    int traceRead(ScanTraceEvent* events, int maxEvents) {
+        std::lock_guard<std::mutex> lock(traceMutex_);
+        
+        int count = 0;
+        
+        while (count < maxEvents && !traceEvents_.empty()) {
+            events[count++] = traceEvents_.front();
+            traceEvents_.pop_front();
+        }
+        
+        return count;
+    }
 
 private:
     void engineLoop() {
@@ -213,7 +254,7 @@ private:
             sendMessage("wait");
             
             while (!shouldStop_.load()) {
-                std::string command;
+                QueuedCommand command {"", 0};
                 
                 // Wait for command
                 {
@@ -231,8 +272,14 @@ private:
                     }
                 }
                 
-                if (!command.empty()) {
-                    processCommand(command);
+                if (!command.line.empty()) {
+                    currentCommand_ = command.id;
+                    trace(currentCommand_, "pop");
+                    
+                    processCommand(command.line);
+                    
+                    trace(currentCommand_, "handled");
+                    currentCommand_ = 0;
                 }
             }
             
@@ -257,6 +304,7 @@ private:
             }
             
             std::string command = scan.get_command();
+            trace(currentCommand_, "dispatch");
             
             if (command == "hub") {
                 handleHubCommand(scan);
@@ -297,38 +345,39 @@ private:
         sendMessage("param name=book value=true type=bool");
         sendMessage("param name=book-ply value=4 type=int min=0 max=20");
         sendMessage("param name=book-margin value=4 type=int min=0 max=100");
+        sendMessage("param name=book-canonical value=false type=bool");
         sendMessage("param name=threads value=1 type=int min=1 max=16");
         sendMessage("param name=tt-size value=24 type=int min=16 max=30");
-        sendMessage("param name=bb-size value=5 type=int min=0 max=7");
+        sendMessage("param name=bb-size value=5 type=int min=0 max=8");
+        sendMessage("param name=bb-flat value=16 type=int min=0 max=4096");
+        sendMessage("param name=bb-lazy value=false type=bool");
         
         sendMessage("wait");
     }
     
     void handleInitCommand(hub::Scanner& scan) {
         try {
-            bit::init();
+            // book, bitbases, eval, sort and TT load concurrently; init() returns after all of them
+            startup::Report report = startup::init();
             
-            if (var::Book) {
-                try {
-                    book::init();
-                } catch (...) {
-                    var::set("book", "false");
-                    var::update();
-                }
+            // fallbacks only after the barrier, the phases read var::
+            if (!report.ok("book")) {
+                var::set("book", "false");
+                var::update();
             }
             
-            if (var::BB) {
-                try {
-                    bb::init();
-                } catch (...) {
-                    var::set("bb-size", "0");
-                    var::update();
-                }
+            if (!report.ok("bb")) {
+                var::set("bb-size", "0");
+                var::update();
             }
             
-            eval_init();
-            G_TT.set_size(var::TT_Size);
+            for (const startup::Phase& phase : report.phase) {
+                if (phase.error != nullptr && phase.name != "book" && phase.name != "bb") {
+                    std::rethrow_exception(phase.error);
+                }
+            }
             
+            sendMessage("info message=\"" + report.to_string() + "\"");
             sendMessage("ready");
             
         } catch (const std::exception& e) {
@@ -407,16 +456,28 @@ private:
             }
             
             // Perform search
-            Search_Input si;
+            Search_Input si = level_;
             si.move = !analyze;
             si.book = !analyze;
             si.input = false;
             si.output = Output_None; // We'll handle output ourselves
             si.ponder = ponder;
             
+            level_.init(); // as in hub mode, "level" applies to the next search only
+            
             Search_Output so;
+            
+            long long start = traceTime();
+            trace(currentCommand_, "search-start", start);
+            
             search(so, engineGame_.node(), si);
             
+            if (so.first_time >= 0.0) { // measured by the search itself, relative to its start
+                trace(currentCommand_, "search-first-info", start + (long long)(so.first_time * 1E9));
+            }
+            
+            trace(currentCommand_, "search-end");
+            
             Move move = so.move;
             Move answer = so.answer;
             
@@ -448,9 +509,12 @@ private:
     }
     
     void handleLevelCommand(hub::Scanner& scan) {
-        // Handle level commands (depth, time, etc.)
-        // Implementation depends on specific requirements
-        sendMessage("info message=\"level command processed\"");
+        // Same pairs as in hub mode, each "level" command adds to the previous ones
+        try {
+            level_.set_level(scan);
+        } catch (const std::exception& e) {
+            sendMessage("error message=\"invalid level: " + std::string(e.what()) + "\"");
+        }
     }
     
     void handleStopCommand(hub::Scanner& scan) {
@@ -496,6 +560,8 @@ private:
     }
     
     void sendMessage(const std::string& message) {
+        trace(currentCommand_, "send");
+        
         std::lock_guard<std::mutex> lock(callbackMutex_);
         if (messageCallback_) {
             try {
@@ -514,6 +580,29 @@ private:
         std::lock_guard<std::mutex> lock(errorMutex_);
         lastError_ = error;
     }
+    
+    static long long traceTime() {
+        auto now = std::chrono::steady_clock::now().time_since_epoch();
+        return (long long)std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+    }
+    
+    void trace(unsigned long long command, const char* point, long long time = -1) {
+        if (!traceEnabled_.load(std::memory_order_relaxed)) {
+            return;
+        }
+        
+        if (time < 0) {
+            time = traceTime();
+        }
+        
+        std::lock_guard<std::mutex> lock(traceMutex_);
+        
+        if (traceEvents_.size() >= Trace_Size) {
+            traceEvents_.pop_front(); // keep the latest
+        }
+        
+        traceEvents_.push_back({command, point, time});
+    }
 };
 
 // Static instance
@@ -585,6 +674,19 @@ bool Engine::waitReady(int timeoutSeconds) {
     return pImpl->waitReady(timeoutSeconds);
 }
 
+void Engine::traceEnable(bool enable) {
+    if (pImpl) {
+        pImpl->traceEnable(enable);
+    }
+}
+
+int Engine::traceRead(ScanTraceEvent* events, int maxEvents) {
+    if (!pImpl || !events || maxEvents <= 0) {
+        return 0;
+    }
+    return pImpl->traceRead(events, maxEvents);
+}
+
 } // namespace ScanBridge
 
 // C interface implementation
@@ -647,4 +749,12 @@ bool scan_bridge_wait_ready(int timeout_seconds) {
     return ScanBridge::Engine::getInstance().waitReady(timeout_seconds);
 }
 
+void scan_bridge_trace_enable(bool enable) {
+    ScanBridge::Engine::getInstance().traceEnable(enable);
+}
+
+int scan_bridge_trace_read(ScanTraceEvent* events, int max_events) {
+    return ScanBridge::Engine::getInstance().traceRead(events, max_events);
+}
+
 }
\ No newline at end of file
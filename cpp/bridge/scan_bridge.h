@@ -31,6 +31,14 @@ typedef enum {
     SCAN_ERROR_TIMEOUT = -6
 } ScanResult;
 
+// Trace event, see scan_bridge_trace_enable()
+// points: "push", "pop", "dispatch", "search-start", "search-first-info", "search-end", "send", "handled"
+typedef struct {
+    unsigned long long command; // sequence number from scan_bridge_send_command(), 0 = none
+    const char* point;          // static string
+    long long time_ns;          // steady clock, only differences are meaningful
+} ScanTraceEvent;
+
 // Initialize the Scan engine bridge
 ScanResult scan_bridge_init(void);
 
@@ -58,6 +66,12 @@ bool scan_bridge_is_ready(void);
 // Wait for engine to be ready (with timeout in seconds)
 bool scan_bridge_wait_ready(int timeout_seconds);
 
+// Record timestamped trace points (off by default, the buffer keeps the latest 65536 events)
+void scan_bridge_trace_enable(bool enable);
+
+// Move up to max_events recorded events (oldest first) into events, returns their number
+int scan_bridge_trace_read(ScanTraceEvent* events, int max_events);
+
 #ifdef __cplusplus
 }
 
@@ -105,6 +119,10 @@ namespace ScanBridge {
         // Wait for ready state
         bool waitReady(int timeoutSeconds = 10);
         
+        // Latency tracing
+        void traceEnable(bool enable);
+        int traceRead(ScanTraceEvent* events, int maxEvents);
+        
     private:
         Engine() = default;
         ~Engine();
@@ -1,21 +1,39 @@
 
 // includes
 
+#include <algorithm>
+#include <atomic>
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
 #include <map>
+#include <random>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
 
 #include "bb_base.hpp"
 #include "bb_comp.hpp"
 #include "bb_index.hpp"
 #include "common.hpp"
+#include "embed.hpp"
+#include "fen.hpp"
 #include "gen.hpp"
 #include "libmy.hpp"
 #include "list.hpp"
+#include "logger.hpp"
 #include "pos.hpp"
 #include "score.hpp"
+#include "thread.hpp"
+#include "util.hpp"
 #include "var.hpp"
 
 namespace bb {
@@ -24,24 +42,49 @@ namespace bb {
 
 const int Value_Size {4};
 
+const int64 Flat_Small  {int64(1) << 20}; // bytes, always unpacked (budget permitting)
+const int64 Hot_Probes  {int64(1) << 12}; // before a slice can be promoted
+
 // types
 
+struct Probe_Count { // one per search thread, written by its owner only: no shared cache line in the search
+   std::atomic<int64> probes[ID_Size];
+};
+
 class Base {
 
 private:
 
-   ID m_id;
-   Index m_size;
+   ID m_id {};
+   Index m_size {0};
    Index_ m_index;
+   bool m_resolved {false};
+
+   int64 m_probes_0 {0}; // slot counts at load time
+   int64 m_saved {0}; // probes already in the usage file
 
 public:
 
-   void load (ID id);
+   bool load   (ID id); // false if the slice is not on disk (or linked in)
+   void clear  (ID id);
+   bool unpack () { return m_index.unpack(); }
+   int64 save  (); // probes since the last call
+
+   bool  is_load     () const { return m_size != 0; }
+   bool  is_flat     () const { return m_index.is_flat(); }
+   bool  is_resident () const { return m_index.is_resident(); }
+   bool  is_resolved () const { return m_resolved; }
+   int64 flat_size () const { return m_index.flat_size(); }
+   int64 probes    () const; // since load, also for missing slices (see "bb-usage")
 
    ID    id   () const { return m_id; }
    Index size () const { return m_size; }
 
-   int operator [] (Index index) const { return m_index[index]; }
+   int get (Index index, bool block) const { return m_index.get(index, block); }
+
+   int get_ref (Index index) const { return m_index.get_ref(index); }
+
+   void decode (std::vector<uint8> & value) const { m_index.decode(value); }
 };
 
 // "constants"
@@ -52,24 +95,404 @@ const int Order[Value_Size] { 2, 0, 3, 1 }; // DLWU -> LUDW
 
 static Base G_Base[ID_Size];
 
+static int64 G_Flat_Size {0}; // bytes used by unpacked slices
+
+static bool G_Complete {true}; // every slice up to "bb-size" is loaded
+
+static Probe_Count G_Count[Slot_Size]; // threads outside the search share slot 0, they can lose a few counts
+
 // prototypes
 
 static bool is_load (int size);
 
+static std::string file_name (ID id);
+static bool        has_file  (const std::string & file_name); // single or sharded
+
+static std::vector<std::string> slice_files (ID id); // on disk, as load() would read them
+static int64 file_size  (const std::string & file_name);
+static void  copy_file  (const std::string & from, const std::string & to);
+static void  make_dirs  (const std::string & file_name);
+
+static bool unpack (Base & base);
+
+static void  count       (ID id, int slot);
+static int64 count_total (ID id);
+
+static bool usage_load (const std::string & file_name, std::map<std::string, int64> & usage);
+
+static void sample_block (std::string & text, ID id, Index begin, Index end);
+static void sample_rand  (std::string & text, ID id, int64 size, std::mt19937_64 & rand);
+
 // functions
 
 void init() {
 
-   std::cout << "init bitbase" << std::endl;
+   logger::put(logger::Level::Info, "init bitbase");
+
+   G_Flat_Size = 0; // re-init, the slices are loaded again
+   loader_drain(); // "bb-lazy": queued shards are about to be freed
+
+   usage_save(); // re-init: flush the probes counted since the last search before the snapshots move
+
+   for (int i = 0; i < ID_Size; i++) { // re-init: also slices above a smaller "bb-size" or from another variant
+      G_Base[i].clear(ID(i));
+   }
+
+   int missing = 0;
 
    for (int i = 0; i < ID_Size; i++) {
 
       ID id = ID(i);
 
       if (!id_is_illegal(id) && !id_is_end(id) && is_load(id_size(id))) {
-         G_Base[id].load(id);
+         if (!G_Base[id].load(id)) missing += 1; // partial set, see "scan bb-pack"
+      }
+   }
+
+   G_Complete = missing == 0;
+
+   if (!G_Complete) {
+      logger::put(logger::Level::Info, "bitbase: " + std::to_string(missing) + " slices missing, probed as unknown");
+   }
+
+   // small slices are probed constantly and cheap to keep as flat tables
+
+   std::vector<Base *> list;
+
+   for (Base & base : G_Base) {
+      if (base.is_load() && base.flat_size() <= Flat_Small) list.push_back(&base);
+   }
+
+   std::sort(list.begin(), list.end(), [](const Base * b0, const Base * b1) {
+      return b0->flat_size() < b1->flat_size();
+   });
+
+   for (Base * base : list) {
+      if (!unpack(*base)) break;
+   }
+}
+
+void promote() { // not thread safe, call between searches
+
+   if (!var::BB) return;
+
+   std::vector<std::pair<double, Base *>> list; // probes per byte
+
+   for (Base & base : G_Base) {
+
+      if (!base.is_load() || base.is_flat() || !base.is_resident()) continue;
+
+      int64 probes = base.probes();
+      if (probes >= Hot_Probes) list.push_back({ double(probes) / double(base.flat_size()), &base });
+   }
+
+   // most probes per byte first
+
+   std::sort(list.begin(), list.end(), [](const std::pair<double, Base *> & p0, const std::pair<double, Base *> & p1) {
+      return p0.first > p1.first;
+   });
+
+   for (auto & p : list) {
+      unpack(*p.second); // skips slices that don't fit
+   }
+}
+
+void shard(int64 shard_size) {
+
+   for (int i = 0; i < ID_Size; i++) {
+
+      ID id = ID(i);
+      if (id_is_illegal(id) || id_is_end(id) || !is_load(id_size(id))) continue;
+
+      std::cout << id_name(id) << std::endl;
+
+      for (const std::string & name : { file_name(id), file_name(id) + ".res" }) {
+         if (std::ifstream(name)) shard_file(name, shard_size);
+      }
+   }
+}
+
+void resolve() { // capture positions get their QS value, quiet ones are copied
+
+   if (!G_Complete) {
+      std::cerr << "bb-resolve needs every slice up to \"bb-size\"" << std::endl;
+      std::exit(EXIT_FAILURE);
+   }
+
+   for (int size = 2; size <= var::BB_Size; size++) { // successors of captures first
+
+      for (int i = 0; i < ID_Size; i++) {
+
+         ID id = ID(i);
+         if (id_is_illegal(id) || id_is_end(id) || id_size(id) != size) continue;
+
+         const Base & base = G_Base[id];
+         if (base.is_resolved()) continue;
+
+         std::vector<uint8> value;
+         base.decode(value);
+
+         int64 captures = 0;
+
+         for (Index index = 0; index < base.size(); index++) {
+
+            Pos pos;
+            if (!index_to_pos(id, index, pos)) continue; // no such position, keep the filler
+            assert(pos_index(id, pos) == index);
+
+            if (pos::is_capture(pos)) {
+               value[index] = uint8(probe(pos));
+               captures += 1;
+            }
+         }
+
+         std::cout << id_name(id) << ": " << captures << "/" << base.size() << " capture positions" << std::endl;
+
+         encode_file(file_name(id) + ".res", value);
+      }
+   }
+}
+
+void sample(ID id, int64 size, int threads, const std::string & file_name) {
+
+   assert(!id_is_illegal(id) && !id_is_end(id) && is_load(id_size(id)));
+
+   if (!G_Base[id].is_load()) {
+      std::cerr << "missing slice " << id_name(id) << std::endl;
+      std::exit(EXIT_FAILURE);
+   }
+
+   std::ofstream file(file_name);
+
+   if (!file) {
+      std::cerr << "unable to open file \"" << file_name << "\"" << std::endl;
+      std::exit(EXIT_FAILURE);
+   }
+
+   const int64 Block_Size {1 << 16}; // positions per lock
+
+   bool all = size == 0;
+   if (all) size = int64(index_size(id));
+
+   std::atomic<int64> next {0};
+   int64 written = 0;
+   Lockable sync;
+
+   Timer timer;
+   timer.start();
+
+   auto worker = [&](uint64 seed) {
+
+      std::mt19937_64 rand(seed);
+      std::string text;
+
+      while (true) {
+
+         int64 begin = next.fetch_add(Block_Size);
+         if (begin >= size) break;
+
+         int64 end = std::min(begin + Block_Size, size);
+
+         text.clear();
+
+         if (all) {
+            sample_block(text, id, Index(begin), Index(end));
+         } else {
+            sample_rand(text, id, end - begin, rand);
+         }
+
+         sync.lock();
+         file << text;
+         written += std::count(text.begin(), text.end(), '\n');
+         sync.unlock();
+      }
+   };
+
+   std::vector<std::thread> pool;
+
+   for (int i = 0; i < threads; i++) {
+      pool.emplace_back(worker, ml::rand_int_64());
+   }
+
+   for (std::thread & thread : pool) {
+      thread.join();
+   }
+
+   timer.stop();
+   double time = timer.elapsed();
+
+   std::cout << written << " positions in " << ml::ftos(time, 2) << " s (" << ml::ftos(double(written) / std::max(time, 1E-9) / 1E6, 2) << " M/s)" << std::endl;
+}
+
+void usage_save() {
+
+   if (!var::BB || var::BB_Usage.empty()) return;
+
+   std::map<std::string, int64> usage;
+   usage_load(var::BB_Usage, usage); // first run => empty
+
+   bool change = false;
+
+   for (int i = 0; i < ID_Size; i++) {
+
+      ID id = ID(i);
+      if (id_is_illegal(id) || id_is_end(id)) continue; // not "bb-size": it may have changed before a re-init
+
+      int64 probes = G_Base[id].save();
+
+      if (probes != 0) {
+         usage[id_name(id)] += probes;
+         change = true;
       }
    }
+
+   if (!change) return;
+
+   std::ofstream file(var::BB_Usage);
+
+   if (!file) {
+      std::cerr << "unable to open file \"" << var::BB_Usage << "\"" << std::endl;
+      std::exit(EXIT_FAILURE);
+   }
+
+   file << "# probes per slice, see \"scan bb-pack\"\n";
+
+   for (const auto & p : usage) {
+      file << p.first << ' ' << p.second << '\n';
+   }
+}
+
+void pack(const std::string & usage_file, int64 budget, const std::string & dir) {
+
+   std::map<std::string, int64> usage;
+
+   if (!usage_load(usage_file, usage)) {
+      std::cerr << "unable to open file \"" << usage_file << "\"" << std::endl;
+      std::exit(EXIT_FAILURE);
+   }
+
+   struct Slice {
+      ID id;
+      int64 probes;
+      int64 size; // bytes
+      std::vector<std::string> files;
+   };
+
+   std::vector<Slice> list;
+   int64 total = 0; // probes
+
+   for (int i = 0; i < ID_Size; i++) {
+
+      ID id = ID(i);
+      if (id_is_illegal(id) || id_is_end(id) || !is_load(id_size(id))) continue;
+
+      auto it = usage.find(id_name(id));
+      int64 probes = (it != usage.end()) ? it->second : 0;
+
+      total += probes;
+      if (probes == 0) continue; // never used, not worth any byte
+
+      Slice slice { id, probes, 0, slice_files(id) };
+      if (slice.files.empty()) continue; // not on disk
+
+      for (const std::string & name : slice.files) {
+         slice.size += file_size(name);
+      }
+
+      list.push_back(slice);
+   }
+
+   // most probes per byte first, then whatever still fits
+
+   std::sort(list.begin(), list.end(), [](const Slice & s0, const Slice & s1) {
+      return double(s0.probes) / double(std::max(s0.size, int64(1))) > double(s1.probes) / double(std::max(s1.size, int64(1)));
+   });
+
+   int64 used = 0;
+   int64 covered = 0;
+   int slices = 0;
+
+   for (const Slice & slice : list) {
+
+      if (used + slice.size > budget) continue;
+
+      used += slice.size;
+      covered += slice.probes;
+      slices += 1;
+
+      for (const std::string & name : slice.files) {
+         copy_file(name, dir + "/" + name);
+      }
+
+      std::cout << id_name(slice.id) << ": " << ml::ftos(double(slice.size) / 1024.0, 1) << " KB, " << slice.probes << " probes" << std::endl;
+   }
+
+   std::cout << slices << "/" << list.size() << " slices, " << ml::ftos(double(used) / double(1 << 20), 2) << " MB";
+   std::cout << ", " << ml::ftos(double(covered) / double(std::max(total, int64(1))) * 100.0, 2) << "% of probes" << std::endl;
+}
+
+static bool usage_load(const std::string & file_name, std::map<std::string, int64> & usage) {
+
+   std::ifstream file(file_name);
+   if (!file) return false;
+
+   std::string line;
+
+   while (std::getline(file, line)) {
+
+      if (line.empty() || line[0] == '#') continue;
+
+      std::stringstream ss(line);
+
+      std::string name;
+      int64 probes;
+
+      if (ss >> name >> probes) usage[name] += probes;
+   }
+
+   return true;
+}
+
+static void sample_block(std::string & text, ID id, Index begin, Index end) { // every position, White to move
+
+   for (Index index = begin; index < end; index++) {
+
+      Pos pos;
+      if (!index_to_pos(id, index, pos)) continue;
+
+      text += pos_hub(pos);
+      text += ' ';
+      text += value_to_string(probe(pos));
+      text += '\n';
+   }
+}
+
+static void sample_rand(std::string & text, ID id, int64 size, std::mt19937_64 & rand) { // either side to move
+
+   Index index_size = bb::index_size(id);
+
+   for (int64 i = 0; i < size; i++) {
+
+      Pos pos;
+      while (!index_to_pos(id, Index(rand() % index_size), pos, side_make(int(rand() & 1)))) {}
+
+      text += pos_hub(pos);
+      text += ' ';
+      text += value_to_string(probe(pos));
+      text += '\n';
+   }
+}
+
+static bool unpack(Base & base) {
+
+   assert(!base.is_flat());
+
+   int64 budget = int64(var::BB_Flat) << 20;
+   if (G_Flat_Size + base.flat_size() > budget) return false;
+
+   if (base.unpack()) G_Flat_Size += base.flat_size(); // else a bad shard, probed as unknown
+
+   return true;
 }
 
 static bool is_load(int size) {
@@ -77,17 +500,32 @@ static bool is_load(int size) {
 }
 
 bool pos_is_load(const Pos & pos) {
-   return is_load(pos::size(pos));
+   if (!is_load(pos::size(pos))) return false;
+   if (G_Complete) return true;
+
+   ID id = pos_id(pos); // partial set, see "scan bb-pack"
+   return id_is_end(id) || G_Base[id].is_load();
+}
+
+bool pos_is_known(const Pos & pos) {
+   return pos_is_load(pos) && (G_Complete || probe(pos) != Unknown); // a capture can lead to a missing slice
 }
 
 bool pos_is_search(const Pos & pos, int bb_size) {
    return pos::size(pos) <= bb_size && pos_is_load(pos);
 }
 
+bool pos_is_resolved(const Pos & pos) {
+   ID id = pos_id(pos);
+   return !id_is_end(id) && G_Base[id].is_resolved();
+}
+
 int probe(const Pos & pos) {
 
    if (pos::is_wipe(pos)) return value_from_nega(pos::result(pos, pos.turn())); // for BT variant
 
+   if (pos_is_resolved(pos)) return probe_raw(pos); // single lookup
+
    List list;
    gen_captures(list, pos);
 
@@ -98,40 +536,223 @@ int probe(const Pos & pos) {
    } else { // capture position
 
       int node = Loss;
+      bool unknown = false; // missing slice
 
       for (Move mv : list) {
-         node = value_update(node, probe(pos.succ(mv)));
+
+         int child = probe(pos.succ(mv));
+
+         if (child == Unknown) {
+            unknown = true;
+            continue;
+         }
+
+         node = value_update(node, child);
          if (node == Win) break;
       }
 
-      return node;
+      return (unknown && node != Win) ? int(Unknown) : node;
    }
 }
 
-int probe_raw(const Pos & pos) {
+int probe_rec(const Pos & pos, int64 & lookups) {
 
-   assert(!pos::is_capture(pos));
+   if (pos::is_wipe(pos)) return value_from_nega(pos::result(pos, pos.turn())); // for BT variant
+
+   List list;
+   gen_captures(list, pos);
+
+   if (list.size() == 0) { // quiet position
+
+      lookups += 1;
+      return probe_raw(pos);
+
+   } else { // capture position
+
+      int node = Loss;
+
+      for (Move mv : list) {
+         node = value_update(node, probe_rec(pos.succ(mv), lookups));
+         if (node == Win) break;
+      }
+
+      return node;
+   }
+}
+
+int probe_raw(const Pos & pos, bool block, int slot) {
 
    ID id = pos_id(pos);
    assert(!id_is_illegal(id));
    if (id_is_end(id)) return (var::Variant == var::Losing) ? Win : Loss;
 
+   count(id, slot);
+
    const Base & base = G_Base[id];
+   if (!base.is_load()) return Unknown; // partial set
+
+   assert(base.is_resolved() || !pos::is_capture(pos));
    Index index = pos_index(id, pos);
 
-   int value = base[index];
-   assert(value != Unknown);
+   int value = base.get(index, block);
+   assert(value != Unknown || !block);
 
    return value;
 }
 
-void Base::load(ID id) {
+int probe_raw_ref(const Pos & pos) {
+
+   assert(!pos::is_capture(pos));
+
+   ID id = pos_id(pos);
+   assert(!id_is_illegal(id));
+   if (id_is_end(id)) return (var::Variant == var::Losing) ? Win : Loss;
+
+   const Base & base = G_Base[id];
+   if (!base.is_load()) return Unknown;
+
+   return base.get_ref(pos_index(id, pos));
+}
+
+bool Base::load(ID id) {
+
+   clear(id);
+
+   std::string name = file_name(id);
+
+   m_resolved = has_file(name + ".res"); // see resolve()
+   if (m_resolved) name += ".res";
+
+   if (!has_file(name)) return false; // "not in base"
 
-   m_id = id;
    m_size = index_size(id);
 
-   std::string file_name = std::string("data/bb") + var::variant_name() + "/" + std::to_string(id_size(id)) + "/" + id_name(id);
-   m_index.load(file_name, m_size);
+   if (!m_index.load(name, m_size, var::BB_Lazy)) { // bad shard, same as missing
+      m_size = 0;
+      return false;
+   }
+
+   return true;
+}
+
+void Base::clear(ID id) {
+
+   m_id = id;
+   m_size = 0;
+   m_resolved = false;
+   m_index.clear();
+
+   m_probes_0 = count_total(id);
+   m_saved = 0;
+}
+
+int64 Base::probes() const {
+   return count_total(m_id) - m_probes_0;
+}
+
+static void count(ID id, int slot) {
+   assert(slot >= 0 && slot < Slot_Size);
+   std::atomic<int64> & probes = G_Count[slot].probes[id];
+   probes.store(probes.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed); // single writer
+}
+
+static int64 count_total(ID id) {
+
+   int64 total = 0;
+
+   for (const Probe_Count & slot : G_Count) {
+      total += slot.probes[id].load(std::memory_order_relaxed);
+   }
+
+   return total;
+}
+
+int64 Base::save() {
+
+   int64 probes = this->probes();
+   int64 delta = probes - m_saved;
+   m_saved = probes;
+
+   return delta;
+}
+
+static std::string file_name(ID id) {
+   return std::string("data/bb") + var::variant_name() + "/" + std::to_string(id_size(id)) + "/" + id_name(id);
+}
+
+static bool has_file(const std::string & file_name) {
+   return embed::has_file(file_name) || embed::has_file(file_name + ".idx");
+}
+
+static std::vector<std::string> slice_files(ID id) {
+
+   std::string name = file_name(id);
+
+   auto on_disk = [](const std::string & name) {
+      return bool(std::ifstream(name)) || bool(std::ifstream(name + ".idx"));
+   };
+
+   if (on_disk(name + ".res")) name += ".res"; // see Base::load()
+
+   std::vector<std::string> files;
+
+   std::ifstream idx(name + ".idx", std::ios::binary);
+
+   if (idx) { // sharded, see shard_file()
+
+      int shards = int(ml::get_bytes(idx, 4));
+      files.push_back(name + ".idx");
+
+      for (int i = 0; i < shards; i++) {
+         files.push_back(name + "." + std::to_string(i));
+      }
+
+   } else if (std::ifstream(name)) {
+
+      files.push_back(name);
+   }
+
+   return files;
+}
+
+static int64 file_size(const std::string & file_name) {
+
+   std::ifstream file(file_name, std::ios::binary | std::ios::ate);
+
+   if (!file) {
+      std::cerr << "unable to open file \"" << file_name << "\"" << std::endl;
+      std::exit(EXIT_FAILURE);
+   }
+
+   return int64(file.tellg());
+}
+
+static void copy_file(const std::string & from, const std::string & to) {
+
+   make_dirs(to);
+
+   std::ifstream in(from, std::ios::binary);
+   std::ofstream out(to, std::ios::binary);
+
+   if (!in || !out || !(out << in.rdbuf())) {
+      std::cerr << "unable to copy \"" << from << "\" to \"" << to << "\"" << std::endl;
+      std::exit(EXIT_FAILURE);
+   }
+}
+
+static void make_dirs(const std::string & file_name) { // parents only, existing ones are fine
+
+   for (std::size_t i = 1; i < file_name.size(); i++) {
+
+      if (file_name[i] != '/') continue;
+
+      std::string dir = file_name.substr(0, i);
+#ifdef _WIN32
+      _mkdir(dir.c_str());
+#else
+      mkdir(dir.c_str(), 0755);
+#endif
+   }
 }
 
 int value_update(int node, int child) {
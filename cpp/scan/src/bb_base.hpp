@@ -13,19 +13,36 @@ class Pos;
 
 namespace bb {
 
+enum ID : int;
+
+// constants
+
+const int Slot_Size {16}; // probe counters, one per search thread (see probe_raw())
+
 // types
 
 enum Value : int { Draw, Loss, Win, Unknown };
 
 // functions
 
-void init ();
+void init    ();
+void promote (); // unpack frequently probed slices
+void shard   (int64 shard_size); // split slice files, see bb::shard_file()
+void resolve (); // write capture-resolved slice files
+void sample  (ID id, int64 size, int threads, const std::string & file_name); // positions with their value, all of them if size = 0
+
+void usage_save (); // adds the probes since the last call to the "bb-usage" file
+void pack       (const std::string & usage_file, int64 budget, const std::string & dir); // copy the most probed slices per byte
 
-bool pos_is_load   (const Pos & pos);
-bool pos_is_search (const Pos & pos, int bb_size);
+bool pos_is_load     (const Pos & pos); // slice loaded, cheap (the value of a capture can still be unknown)
+bool pos_is_known    (const Pos & pos); // value known, full probe: not for the search
+bool pos_is_search   (const Pos & pos, int bb_size);
+bool pos_is_resolved (const Pos & pos); // capture positions are stored too
 
-int probe     (const Pos & pos); // QS
-int probe_raw (const Pos & pos); // quiet position
+int probe         (const Pos & pos); // QS, unknown if a slice is missing
+int probe_rec     (const Pos & pos, int64 & lookups); // QS by recursion only, for testing
+int probe_raw     (const Pos & pos, bool block = true, int slot = 0); // quiet or resolved position, unknown if not resident and !block
+int probe_raw_ref (const Pos & pos); // full RLE scan, for testing
 
 int value_update (int node, int child);
 
@@ -2,15 +2,21 @@
 // includes
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <cstdlib>
+#include <deque>
 #include <fstream>
 #include <iostream>
+#include <mutex>
 #include <string>
+#include <thread>
 
 #include "bb_comp.hpp"
 #include "common.hpp"
+#include "embed.hpp"
 #include "libmy.hpp"
+#include "thread.hpp"
 #include "util.hpp"
 
 namespace bb {
@@ -21,6 +27,10 @@ const int RLE_Size {255 / 3};
 
 const Index Block_Size {1 << 8};
 
+// types
+
+enum Shard_State : int { Shard_Absent, Shard_Queued, Shard_Resident, Shard_Failed };
+
 // variables
 
 static Index RLE[RLE_Size + 1];
@@ -28,6 +38,23 @@ static Index RLE[RLE_Size + 1];
 static int Code_Value[256];
 static Index Code_Length[256];
 
+static Lockable G_Load; // one shard at a time
+
+// HACK: never freed, the detached loader outlives static destructors
+
+static Waitable * G_Wake {nullptr};
+static std::once_flag G_Loader;
+static std::deque<Shard *> G_Queue;
+static Shard * G_Busy {nullptr}; // being loaded, guarded by G_Wake
+
+static std::atomic<int64> G_Skipped {0};
+static std::atomic<int64> G_Loaded {0};
+
+// prototypes
+
+static void request (Shard & shard);
+static void loader  ();
+
 // functions
 
 void comp_init() {
@@ -42,57 +69,206 @@ void comp_init() {
    }
 }
 
-void Index_::load(const std::string & file_name, Index size) {
+bool Index_::load(const std::string & file_name, Index size, bool lazy) { // see loader_drain()
 
-   std::ifstream file(file_name, std::ios::binary);
+   m_size = size;
+   std::vector<uint8>().swap(m_flat); // re-init: no stale table, see get()
 
-   if (!file) {
-      std::cerr << "unable to open file \"" << file_name << "\"" << std::endl;
-      std::exit(EXIT_FAILURE);
+   std::vector<Index> start;
+   std::vector<std::string> name;
+
+   embed::In_File file(file_name + ".idx");
+
+   if (file) { // sharded slice, see shard_file()
+
+      int shards = int(ml::get_bytes(file, 4));
+
+      for (int i = 0; i < shards; i++) {
+         start.push_back(Index(ml::get_bytes(file, 8)));
+         name.push_back(file_name + "." + std::to_string(i));
+      }
+
+      if (!file || shards == 0 || start[0] != 0 || !std::is_sorted(start.begin(), start.end())) {
+         std::cerr << "corrupted file \"" << file_name << ".idx\"" << std::endl;
+         std::exit(EXIT_FAILURE);
+      }
+
+   } else {
+
+      start.push_back(0);
+      name.push_back(file_name);
    }
 
-   m_size = size;
-   load_file(m_table, file);
+   int shards = int(start.size());
+   m_shard = std::vector<Shard>(shards); // Shard is not movable
+
+   for (int i = 0; i < shards; i++) {
+
+      Shard & shard = m_shard[i];
+
+      shard.start = start[i];
+      shard.end = (i + 1 < shards) ? start[i + 1] : m_size;
+      shard.file_name = name[i];
+      shard.state = Shard_Absent;
+   }
+
+   if (!lazy) {
+      for (Shard & shard : m_shard) {
+         if (!shard.load()) return false;
+      }
+   }
+
+   return true;
+}
+
+void Index_::clear() { // see loader_drain()
+   m_size = 0;
+   m_shard.clear();
+   std::vector<uint8>().swap(m_flat);
+}
+
+bool Shard::load() {
+
+   int state_0 = state.load(std::memory_order_acquire);
+   if (state_0 == Shard_Resident) return true;
+   if (state_0 == Shard_Failed) return false;
+
+   G_Load.lock();
+
+   if (state.load() != Shard_Resident && state.load() != Shard_Failed) {
+
+      const embed::Image * image = embed::find(file_name);
+
+      if (image != nullptr) { // used in place
+
+         table = image->data;
+         table_size = Index(image->size);
+
+      } else {
+
+         std::ifstream file(file_name, std::ios::binary);
+
+         if (!file) { // can be the loader thread, report and probe as unknown
+            std::cerr << "unable to open file \"" << file_name << "\"" << std::endl;
+            state.store(Shard_Failed, std::memory_order_release);
+            G_Load.unlock();
+            return false;
+         }
 
-   // create index table for on-line decompression
+         load_file(buffer, file);
 
-   Index table_size = Index(m_table.size());
-   Index index_size = (table_size + Block_Size - 1) / Block_Size;
+         table = buffer.data();
+         table_size = Index(buffer.size());
+      }
+
+      // create index table for on-line decompression
+
+      Index index_size = (table_size + Block_Size - 1) / Block_Size;
+
+      index.clear();
+      index.reserve(index_size + 1); // sentinel
+
+      Index pos = 0;
+
+      for (Index i = 0; i < table_size;) {
 
-   m_index.clear();
-   m_index.reserve(index_size + 1); // sentinel for debug
+         assert(i % Block_Size == 0);
+         index.push_back(pos);
+
+         Index next = std::min(i + Block_Size, table_size);
+
+         for (; i < next; i++) {
+            pos += Code_Length[table[i]];
+         }
+      }
+
+      assert(Index(index.size()) == index_size);
+      index.push_back(pos); // sentinel = positions in this shard
+
+      if (start + pos != end) { // shards must tile the slice
+         std::cerr << "unmatched uncompressed size: " << file_name << ": " << (end - start) << " -> " << pos << std::endl;
+         std::vector<uint8>().swap(buffer);
+         state.store(Shard_Failed, std::memory_order_release);
+         G_Load.unlock();
+         return false;
+      }
+
+      state.store(Shard_Resident, std::memory_order_release);
+   }
+
+   G_Load.unlock();
+
+   return state.load(std::memory_order_acquire) == Shard_Resident;
+}
+
+bool Index_::unpack() { // keeps the RLE tables for get_ref()
+
+   m_flat.assign(flat_size(), 0);
 
    Index pos = 0;
 
-   for (Index i = 0; i < table_size;) {
+   for (Shard & shard : m_shard) {
+
+      if (!shard.load()) {
+         std::vector<uint8>().swap(m_flat);
+         return false;
+      }
 
-      assert(i % Block_Size == 0);
-      m_index.push_back(pos);
+      assert(pos == shard.start);
 
-      Index next = std::min(i + Block_Size, table_size);
+      for (Index i = 0; i < shard.table_size; i++) {
 
-      for (; i < next; i++) {
-         pos += Code_Length[m_table[i]];
+         uint8 byte = shard.table[i];
+         uint8 value = Code_Value[byte];
+
+         for (Index end = pos + Code_Length[byte]; pos < end; pos++) {
+            m_flat[pos / 4] |= value << (pos % 4 * 2);
+         }
       }
    }
 
-   if (pos != m_size) {
-      std::cerr << "unmatched uncompressed size: " << file_name << ": " << m_size << " -> " << pos << std::endl;
-      std::exit(EXIT_FAILURE);
+   assert(pos == m_size);
+
+   return true;
+}
+
+bool Index_::is_resident() const {
+
+   for (const Shard & shard : m_shard) {
+      if (shard.state.load(std::memory_order_acquire) != Shard_Resident) return false;
    }
 
-   assert(Index(m_index.size()) == index_size);
-   m_index.push_back(m_size); // sentinel for debug
+   return true;
 }
 
-int Index_::operator[](Index pos) const {
+int Index_::get(Index pos, bool block) const {
 
    assert(pos < m_size);
 
+   if (!m_flat.empty()) return (m_flat[pos / 4] >> (pos % 4 * 2)) & 3; // O(1)
+
+   Shard & shard = find_shard(pos);
+
+   if (shard.state.load(std::memory_order_acquire) != Shard_Resident) {
+
+      if (!block) { // don't wait for storage
+         G_Skipped.fetch_add(1, std::memory_order_relaxed);
+         request(shard);
+         return 3; // unknown
+      }
+
+      if (!shard.load()) return 3;
+   }
+
+   assert(pos >= shard.start);
+   pos -= shard.start;
+
    // find the compressed block using the index table
 
+   const std::vector<Index> & index = shard.index;
+
    Index low = 0;
-   Index high = m_index.size() - 1;
+   Index high = index.size() - 1;
    assert(low <= high);
 
    while (low < high) {
@@ -100,7 +276,7 @@ int Index_::operator[](Index pos) const {
       Index mid = (low + high + 1) / 2;
       assert(mid > low && mid <= high);
 
-      if (m_index[mid] <= pos) {
+      if (index[mid] <= pos) {
          low = mid;
          assert(low <= high);
       } else {
@@ -110,17 +286,17 @@ int Index_::operator[](Index pos) const {
    }
 
    assert(low == high);
-   assert(m_index[low] <= pos);
-   assert(m_index[low + 1] > pos);
+   assert(index[low] <= pos);
+   assert(index[low + 1] > pos);
 
    // find the value using on-line RLE
 
-   assert(pos >= m_index[low]);
-   pos -= m_index[low];
+   assert(pos >= index[low]);
+   pos -= index[low];
 
    for (Index i = low * Block_Size; true; i++) {
 
-      int byte = m_table[i];
+      int byte = shard.table[i];
 
       Index len = Code_Length[byte];
       if (pos < len) return Code_Value[byte];
@@ -128,5 +304,203 @@ int Index_::operator[](Index pos) const {
    }
 }
 
+int Index_::get_ref(Index pos) const {
+
+   assert(pos < m_size);
+
+   for (Shard & shard : m_shard) {
+
+      if (!shard.load()) return 3;
+
+      for (Index i = 0; i < shard.table_size; i++) {
+
+         Index len = Code_Length[shard.table[i]];
+         if (pos < len) return Code_Value[shard.table[i]];
+         pos -= len;
+      }
+   }
+
+   assert(false);
+   return 0;
+}
+
+void Index_::decode(std::vector<uint8> & value) const {
+
+   value.resize(m_size);
+
+   Index pos = 0;
+
+   for (Shard & shard : m_shard) {
+
+      if (!shard.load()) std::exit(EXIT_FAILURE); // commands only, already reported
+
+      for (Index i = 0; i < shard.table_size; i++) {
+         uint8 byte = shard.table[i];
+         Index len = Code_Length[byte];
+         std::fill(value.begin() + pos, value.begin() + pos + len, uint8(Code_Value[byte]));
+         pos += len;
+      }
+   }
+
+   assert(pos == m_size);
+}
+
+Shard & Index_::find_shard(Index pos) const {
+
+   if (m_shard.size() == 1) return m_shard[0];
+
+   auto it = std::upper_bound(m_shard.begin(), m_shard.end(), pos, [](Index pos, const Shard & shard) {
+      return pos < shard.start;
+   });
+
+   assert(it != m_shard.begin());
+   return *(it - 1);
+}
+
+int64 probes_skipped() {
+   return G_Skipped;
+}
+
+int64 shards_loaded() {
+   return G_Loaded;
+}
+
+void loader_drain() { // no search is running, only the loader can still hold a shard
+
+   if (G_Wake == nullptr) return; // never started
+
+   while (true) {
+
+      G_Wake->lock();
+
+      for (Shard * shard : G_Queue) {
+         shard->state.store(Shard_Absent);
+      }
+
+      G_Queue.clear();
+      bool busy = G_Busy != nullptr;
+
+      G_Wake->unlock();
+
+      if (!busy) break;
+      std::this_thread::yield();
+   }
+}
+
+static void request(Shard & shard) {
+
+   int state = Shard_Absent;
+   if (!shard.state.compare_exchange_strong(state, Shard_Queued)) return; // queued or resident
+
+   std::call_once(G_Loader, []() {
+      G_Wake = new Waitable;
+      std::thread(loader).detach();
+   });
+
+   G_Wake->lock();
+   G_Queue.push_back(&shard);
+   G_Wake->signal();
+   G_Wake->unlock();
+}
+
+static void loader() {
+
+   while (true) {
+
+      G_Wake->lock();
+      while (G_Queue.empty()) G_Wake->wait();
+
+      Shard * shard = G_Queue.front();
+      G_Queue.pop_front();
+      G_Busy = shard;
+
+      G_Wake->unlock();
+
+      if (shard->load()) G_Loaded += 1;
+
+      G_Wake->lock();
+      G_Busy = nullptr;
+      G_Wake->unlock();
+   }
+}
+
+void encode_file(const std::string & file_name, const std::vector<uint8> & value) {
+
+   std::ofstream file(file_name, std::ios::binary);
+
+   Index size = Index(value.size());
+
+   for (Index pos = 0; pos < size;) {
+
+      int val = value[pos];
+      assert(val >= 0 && val < 3);
+
+      Index run = 1;
+      while (pos + run < size && value[pos + run] == val) run++;
+
+      pos += run;
+
+      while (run != 0) { // greedy, longest code first
+
+         int code = RLE_Size - 1;
+         while (RLE[code] > run) code--;
+
+         file.put(char(code * 3 + val));
+         run -= RLE[code];
+      }
+   }
+
+   if (!file) {
+      std::cerr << "unable to write file \"" << file_name << "\"" << std::endl;
+      std::exit(EXIT_FAILURE);
+   }
+}
+
+void shard_file(const std::string & file_name, int64 shard_size) {
+
+   std::ifstream file(file_name, std::ios::binary);
+
+   if (!file) {
+      std::cerr << "unable to open file \"" << file_name << "\"" << std::endl;
+      std::exit(EXIT_FAILURE);
+   }
+
+   std::vector<uint8> table;
+   load_file(table, file);
+
+   int64 size = std::max(shard_size / int64(Block_Size), int64(1)) * int64(Block_Size); // whole blocks
+   int shards = int((int64(table.size()) + size - 1) / size);
+
+   std::ofstream idx(file_name + ".idx", std::ios::binary);
+   ml::put_bytes(idx, shards, 4);
+
+   Index pos = 0;
+
+   for (int i = 0; i < shards; i++) {
+
+      auto begin = table.begin() + i * size;
+      auto end = table.begin() + std::min((i + 1) * size, int64(table.size()));
+
+      ml::put_bytes(idx, pos, 8);
+
+      std::ofstream out(file_name + "." + std::to_string(i), std::ios::binary);
+      out.write((const char *) &*begin, end - begin);
+
+      for (auto it = begin; it != end; ++it) {
+         pos += Code_Length[*it]; // RLE codes never straddle shards
+      }
+
+      if (!out) {
+         std::cerr << "unable to write file \"" << file_name << "." << i << "\"" << std::endl;
+         std::exit(EXIT_FAILURE);
+      }
+   }
+
+   if (!idx) {
+      std::cerr << "unable to write file \"" << file_name << ".idx\"" << std::endl;
+      std::exit(EXIT_FAILURE);
+   }
+}
+
 } // namespace bb
 
@@ -4,6 +4,7 @@
 
 // includes
 
+#include <atomic>
 #include <string>
 #include <vector>
 
@@ -15,26 +16,63 @@ namespace bb {
 
 // types
 
+struct Shard { // one file, decoded independently of the others
+
+   Index start; // first position
+   Index end;
+   std::string file_name;
+
+   std::atomic<int> state; // absent, queued or resident
+   std::vector<uint8> buffer; // file contents, unused for images linked into the binary
+   const uint8 * table; // RLE codes
+   Index table_size;
+   std::vector<Index> index; // block -> first position, relative to "start"
+
+   bool load (); // blocking, does nothing if resident, false if the file is missing or bad
+};
+
 class Index_ { // "Index" is already taken
 
 private:
 
    Index m_size;
-   std::vector<uint8> m_table;
-   std::vector<Index> m_index;
+   mutable std::vector<Shard> m_shard; // loaded on demand with "bb-lazy"
+   std::vector<uint8> m_flat; // 2 bits per position, empty = compressed only
 
 public:
 
-   void load (const std::string & file_name, Index size);
+   bool load   (const std::string & file_name, Index size, bool lazy); // "<file>" or "<file>.idx" + "<file>.<n>"
+   bool unpack ();
+   void clear  (); // not loaded
+
+   Index size        () const { return m_size; }
+   int64 flat_size   () const { return (int64(m_size) + 3) / 4; }
+   bool  is_flat     () const { return !m_flat.empty(); }
+   bool  is_resident () const;
+
+   int operator [] (Index pos) const { return get(pos, true); }
+   int get         (Index pos, bool block) const; // 3 (unknown) if not resident and !block
+   int get_ref     (Index pos) const; // full RLE scan, for testing
 
-   Index size        ()          const { return m_size; }
-   int   operator [] (Index pos) const;
+   void decode (std::vector<uint8> & value) const; // one byte per position
+
+private:
+
+   Shard & find_shard (Index pos) const;
 };
 
 // functions
 
 void comp_init ();
 
+int64 probes_skipped (); // non-blocking probes that found their shard absent
+int64 shards_loaded  (); // ... by the background loader
+
+void loader_drain (); // forget queued shards and wait for the current one, before shards are freed
+
+void shard_file  (const std::string & file_name, int64 shard_size); // bytes per shard
+void encode_file (const std::string & file_name, const std::vector<uint8> & value); // RLE
+
 } // namespace bb
 
 #endif // !defined BB_COMP_HPP
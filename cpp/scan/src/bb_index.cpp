@@ -25,7 +25,7 @@ const bool Rev {true}; // argument literal for "reverse"
 
 // types
 
-using Tuple = uint32; // enough for 9 pieces
+using Tuple = uint64;
 
 // variables
 
@@ -39,6 +39,9 @@ static Index pos_index_btm (ID id, const Pos & pos);
 static Tuple tuple_index     (Bit pieces, Bit squares, int p, int n);
 static Tuple tuple_index_rev (Bit pieces, Bit squares, int p, int n);
 
+static Bit tuple_pieces     (Tuple index, Bit squares, int p, int n);
+static Bit tuple_pieces_rev (Tuple index, Bit squares, int p, int n);
+
 static Tuple tuple_size (int p, int n);
 
 static int wolf_index_white (ID id, const Pos & pos, bool rev = false);
@@ -47,6 +50,8 @@ static int wolf_index_black (ID id, const Pos & pos, bool rev = false);
 static int wolf_size_white (ID id);
 static int wolf_size_black (ID id);
 
+static void wolf_set (Pos & pos, Side sd, int index, Bit kings, bool rev);
+
 static int bit_index     (Bit b, Square sq);
 static int bit_index_rev (Bit b, Square sq);
 
@@ -75,7 +80,7 @@ void index_init() {
 }
 
 ID id_make(int wm, int bm, int wk, int bk) {
-   assert(wm + bm + wk + bk < 8);
+   assert(wm + bm + wk + bk <= 8);
    return ID((wm << 9) | (bm << 6) | (wk << 3) | (bk << 0));
 }
 
@@ -207,6 +212,65 @@ static Index pos_index_btm(ID id, const Pos & pos) {
    return index;
 }
 
+bool index_to_pos(ID id, Index index, Pos & pos, Side turn) { // inverse of pos_index()
+
+   assert(index < index_size(id));
+
+#ifndef NDEBUG
+   Index index_0 = index; // for debug
+#endif
+
+   int nwm = id_wm(id);
+   int nbm = id_bm(id);
+   int nwk = id_wk(id);
+   int nbk = id_bk(id);
+
+   int index_wolf_b = 0;
+   int index_wolf_w = 0;
+
+   if (var::Variant == var::Frisian) {
+
+      index_wolf_b = int(index % Index(wolf_size_black(id)));
+      index /= Index(wolf_size_black(id));
+
+      index_wolf_w = int(index % Index(wolf_size_white(id)));
+      index /= Index(wolf_size_white(id));
+   }
+
+   Tuple size_bk = tuple_size(nbk, King_Squares - nwm - nbm - nwk);
+   Tuple index_bk = Tuple(index % size_bk);
+   index /= size_bk;
+
+   Tuple size_wk = tuple_size(nwk, King_Squares - nwm - nbm);
+   Tuple index_wk = Tuple(index % size_wk);
+   index /= size_wk;
+
+   Tuple size_bm = tuple_size(nbm, Man_Squares);
+   Tuple index_bm = Tuple(index % size_bm);
+   index /= size_bm;
+
+   Tuple index_wm = Tuple(index);
+
+   Bit wm = tuple_pieces_rev(index_wm, bit::WM_Squares, nwm, Man_Squares);
+   Bit bm = tuple_pieces(index_bm, bit::BM_Squares, nbm, Man_Squares);
+   if ((wm & bm) != 0) return false; // men are indexed independently
+
+   Bit wk = tuple_pieces_rev(index_wk, bit::Squares ^ wm ^ bm, nwk, King_Squares - nwm - nbm);
+   Bit bk = tuple_pieces(index_bk, bit::Squares ^ wm ^ bm ^ wk, nbk, King_Squares - nwm - nbm - nwk);
+
+   pos = Pos(White, wm, bm, wk, bk);
+
+   if (var::Variant == var::Frisian) {
+      wolf_set(pos, White, index_wolf_w, wk, true);
+      wolf_set(pos, Black, index_wolf_b, bk, false);
+   }
+
+   if (turn == Black) pos = pos.flip(); // pos_index_btm() indexes the flipped position
+
+   assert(pos_id(pos) == id && pos_index(id, pos) == index_0);
+   return true;
+}
+
 Index index_size(ID id) {
 
    int nwm = id_wm(id);
@@ -287,6 +351,77 @@ static Tuple tuple_index_rev(Bit pieces, Bit squares, int p, int n) {
    return index;
 }
 
+static Bit tuple_pieces(Tuple index, Bit squares, int p, int n) { // inverse of tuple_index()
+
+   assert(p >= 0 && p <= P_Max);
+   assert(n >= p && n <= N_Max);
+   assert(bit::count(squares) == n);
+   assert(index < tuple_size(p, n));
+
+   Square square[N_Max];
+
+   int i = 0;
+
+   for (Square sq : squares) {
+      square[i++] = sq;
+   }
+
+   Bit pieces = Bit(0);
+
+   for (int k = p; k > 0; k--) { // combinatorial number system, highest piece first
+
+      // largest pos with C(pos, k) <= index
+
+      int low = k - 1;
+      int high = n - 1;
+
+      while (low < high) {
+
+         int mid = (low + high + 1) / 2;
+
+         if (tuple_size(k, mid) <= index) {
+            low = mid;
+         } else {
+            high = mid - 1;
+         }
+      }
+
+      index -= tuple_size(k, low);
+      bit::set(pieces, square[low]);
+      n = low;
+   }
+
+   assert(index == 0);
+   return pieces;
+}
+
+static Bit tuple_pieces_rev(Tuple index, Bit squares, int p, int n) { // inverse of tuple_index_rev()
+
+   assert(bit::count(squares) == n);
+
+   Bit rev = tuple_pieces(index, squares, p, n); // ranks counted from the top square
+
+   Square square[N_Max];
+
+   int i = 0;
+
+   for (Square sq : squares) {
+      square[(n - 1) - i] = sq;
+      i++;
+   }
+
+   Bit pieces = Bit(0);
+
+   i = 0;
+
+   for (Square sq : squares) {
+      if (bit::has(rev, sq)) bit::set(pieces, square[i]);
+      i++;
+   }
+
+   return pieces;
+}
+
 static Tuple tuple_size(int p, int n) {
    assert(p >= 0 && p <= P_Max);
    assert(n >= 0 && n <= N_Max);
@@ -355,6 +490,26 @@ static int wolf_size_black(ID id) {
    return size;
 }
 
+static void wolf_set(Pos & pos, Side sd, int index, Bit kings, bool rev) { // inverse of wolf_index_*() for White to move
+
+   if (index == 0) return;
+
+   int count = (index - 1) % 3 + 1;
+   int wolf = (index - 1) / 3;
+
+   for (Square sq : kings) {
+
+      int i = rev ? bit_index_rev(kings, sq) : bit_index(kings, sq);
+
+      if (i == wolf) {
+         pos.set_wolf(sd, sq, count);
+         return;
+      }
+   }
+
+   assert(false);
+}
+
 static int bit_index(Bit b, Square sq) {
    assert(bit::has(b, sq));
    return bit::count(b & (ml::bit(sq) - 1));
@@ -19,7 +19,7 @@ const int ID_Size {1 << 12};
 
 // types
 
-using Index = uint32; // enough for 6 pieces (7 for BT variant)
+using Index = uint64; // 8 pieces overflow 32 bits
 
 enum ID : int;
 
@@ -43,7 +43,8 @@ std::string id_name (ID id);
 
 ID pos_id (const Pos & pos);
 
-Index pos_index (ID id, const Pos & pos);
+Index pos_index    (ID id, const Pos & pos);
+bool  index_to_pos (ID id, Index index, Pos & pos, Side turn = White); // false if unused
 
 Index index_size (ID id);
 
@@ -0,0 +1,604 @@
+
+// includes
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "bb_base.hpp"
+#include "bb_index.hpp"
+#include "bench.hpp"
+#include "common.hpp"
+#include "eval.hpp"
+#include "fen.hpp"
+#include "gen.hpp"
+#include "hub.hpp"
+#include "libmy.hpp"
+#include "list.hpp"
+#include "move.hpp"
+#include "pos.hpp"
+#include "search.hpp"
+#include "tt.hpp"
+#include "util.hpp"
+#include "var.hpp"
+
+namespace bench {
+
+// constants
+
+const int Game_Ply {64};
+const int Sample_Ply {8}; // one position every ...
+const Depth Game_Depth {Depth(6)};
+
+// types
+
+struct Run {
+   int threads;
+   double time;
+   int64 node;
+   SMP_Stats smp;
+};
+
+// prototypes
+
+static std::vector<Pos> positions ();
+
+static Search_Output search_depth (const Pos & pos, Depth depth);
+
+static std::vector<Pos> bb_positions (int size);
+static std::vector<Pos> endgame_positions (int size);
+
+static int64 eval_walk (const Pos & pos, Depth depth, int64 & sum);
+
+static int64 perft (const Pos & pos, Depth depth, bool count);
+
+static void write_json (std::ostream & stream, Depth depth, const std::vector<Pos> & ps, const std::vector<Run> & runs);
+
+// functions
+
+void smp(int threads, Depth depth, const std::string & file_name) {
+
+   std::vector<int> counts;
+
+   for (int n = 1; n < threads; n *= 2) {
+      counts.push_back(n);
+   }
+
+   counts.push_back(threads);
+
+   var::set("threads", "1");
+   var::update();
+
+   std::vector<Pos> ps = positions();
+
+   std::vector<Run> runs;
+
+   for (int n : counts) {
+
+      var::set("threads", std::to_string(n));
+      var::update();
+
+      Run run {n, 0.0, 0, SMP_Stats()};
+
+      for (const Pos & pos : ps) {
+
+         G_TT.clear(); // independent searches
+         Search_Output so = search_depth(pos, depth);
+
+         run.time += so.time();
+         run.node += so.node;
+         run.smp.add(so.smp);
+      }
+
+      runs.push_back(run);
+
+      const Run & base = runs[0];
+
+      std::cout << "threads " << n;
+      std::cout << ", time " << ml::ftos(run.time, 2) << "s";
+      std::cout << ", speedup " << ml::ftos(base.time / run.time, 2);
+      std::cout << ", nodes " << ml::ftos(double(run.node) / double(base.node), 2) << "x";
+      std::cout << ", splits " << run.smp.split;
+      std::cout << std::endl;
+   }
+
+   std::ofstream file(file_name);
+
+   if (!file) {
+      std::cerr << "unable to open file \"" << file_name << "\"" << std::endl;
+      std::exit(EXIT_FAILURE);
+   }
+
+   write_json(file, depth, ps, runs);
+
+   std::cout << "wrote \"" << file_name << "\"" << std::endl;
+}
+
+void bb(int size) {
+
+   if (!var::BB) {
+      std::cerr << "bb-bench needs bitbases (bb-size > 0)" << std::endl;
+      std::exit(EXIT_FAILURE);
+   }
+
+   std::vector<Pos> ps = bb_positions(size);
+
+   int captures = 0;
+   int resolved = 0; // in a capture-resolved slice, see "scan bb-resolve"
+
+   for (const Pos & pos : ps) {
+      if (pos::is_capture(pos)) captures += 1;
+      if (bb::pos_is_resolved(pos)) resolved += 1;
+   }
+
+   // recursive probes down to quiet positions
+
+   std::vector<int> rec(ps.size());
+   int64 lookups = 0;
+
+   Timer timer;
+   timer.start();
+
+   for (int i = 0; i < int(ps.size()); i++) {
+      rec[i] = bb::probe_rec(ps[i], lookups);
+   }
+
+   timer.stop();
+   double time_rec = timer.elapsed();
+
+   // probe() uses resolved slices when present
+
+   std::vector<int> val(ps.size());
+
+   timer.reset();
+   timer.start();
+
+   for (int i = 0; i < int(ps.size()); i++) {
+      val[i] = bb::probe(ps[i]);
+   }
+
+   timer.stop();
+   double time = timer.elapsed();
+
+   int diff = 0;
+
+   for (int i = 0; i < int(ps.size()); i++) {
+      if (val[i] != rec[i]) diff += 1;
+   }
+
+   double n = double(std::max(ps.size(), size_t(1)));
+
+   std::cout << ps.size() << " positions, " << ml::ftos(double(captures) / n * 100.0, 1) << "% with captures" << std::endl;
+   std::cout << "recursive: " << ml::ftos(time_rec / n * 1E9, 0) << " ns/probe, " << ml::ftos(double(lookups) / n, 2) << " lookups/probe" << std::endl;
+
+   if (resolved == 0) { // probe() takes the same recursive path, the ratio would be noise
+      std::cout << "probe:     " << ml::ftos(time / n * 1E9, 0) << " ns/probe, no resolved slices loaded (see \"scan bb-resolve\")" << std::endl;
+   } else {
+      std::cout << "probe:     " << ml::ftos(time / n * 1E9, 0) << " ns/probe, speedup " << ml::ftos(time_rec / std::max(time, 1E-9), 2);
+      std::cout << " (" << ml::ftos(double(resolved) / n * 100.0, 1) << "% in resolved slices)" << std::endl;
+   }
+
+   std::cout << diff << " mismatches" << std::endl;
+}
+
+void movegen(Depth depth) {
+
+   std::vector<Pos> ps = positions();
+   ps.insert(ps.begin(), pos::Start);
+
+   int64 leaves = 0;
+   int diff = 0;
+
+   double time_gen = 0.0;
+   double time_count = 0.0;
+
+   for (const Pos & pos : ps) {
+
+      Timer timer;
+      timer.start();
+
+      int64 gen = perft(pos, depth, false);
+
+      timer.stop();
+      time_gen += timer.elapsed();
+
+      timer.reset();
+      timer.start();
+
+      int64 count = perft(pos, depth, true);
+
+      timer.stop();
+      time_count += timer.elapsed();
+
+      if (count != gen) {
+         std::cout << "mismatch: " << count << " vs " << gen << " leaves for " << pos_fen(pos) << std::endl;
+         diff += 1;
+      }
+
+      leaves += gen;
+   }
+
+   std::cout << ps.size() << " positions, perft " << depth << ", " << leaves << " leaves" << std::endl;
+   std::cout << "gen_moves:   " << ml::ftos(double(leaves) / std::max(time_gen, 1E-9) / 1E6, 1) << " M leaves/s" << std::endl;
+   std::cout << "count_moves: " << ml::ftos(double(leaves) / std::max(time_count, 1E-9) / 1E6, 1) << " M leaves/s, speedup " << ml::ftos(time_gen / std::max(time_count, 1E-9), 2) << std::endl;
+   std::cout << diff << " mismatches" << std::endl;
+}
+
+void eval(Depth depth) {
+
+   const int Reps {3}; // best of, cache off and on interleaved
+
+   struct Suite {
+      std::string name;
+      std::vector<Pos> ps;
+   };
+
+   const Suite suites[] {
+      { "middlegame", positions() },
+      { "endgame",    endgame_positions(20) },
+   };
+
+   for (const Suite & suite : suites) {
+
+      std::cout << suite.name << ": " << suite.ps.size() << " positions" << std::endl;
+
+      double time_walk[2] {1E9, 1E9};
+      double time_search[2] {1E9, 1E9};
+
+      int64 evals = 0;
+      int64 node = 0;
+
+      Eval_Stats walk;
+      Eval_Stats search;
+
+      for (int rep = 0; rep < Reps; rep++) {
+
+         for (int on = 0; on < 2; on++) {
+
+            eval_cache(on != 0);
+            eval_cache_clear();
+
+            // eval throughput along depth-first tree walks (search-like locality)
+
+            int64 sum = 0;
+            evals = 0;
+
+            eval_stats_start();
+
+            Timer timer;
+            timer.start();
+
+            for (const Pos & pos : suite.ps) {
+               evals += eval_walk(pos, Depth(5), sum);
+            }
+
+            timer.stop();
+            time_walk[on] = std::min(time_walk[on], timer.elapsed());
+
+            if (on != 0) walk = eval_stats_stop();
+            eval_stats_stop();
+
+            // searches
+
+            double time = 0.0;
+            node = 0;
+
+            eval_cache_clear();
+            eval_stats_start();
+
+            for (const Pos & pos : suite.ps) {
+               G_TT.clear();
+               Search_Output so = search_depth(pos, depth);
+               node += so.node;
+               time += so.time();
+            }
+
+            time_search[on] = std::min(time_search[on], time);
+
+            if (on != 0) search = eval_stats_stop();
+            eval_stats_stop();
+         }
+      }
+
+      std::cout << "  walk:   " << evals << " evals";
+      std::cout << ", " << ml::ftos(double(evals) / time_walk[0] / 1E6, 2) << " -> " << ml::ftos(double(evals) / time_walk[1] / 1E6, 2) << " M evals/s";
+      std::cout << ", " << ml::ftos(double(walk.hit) / double(std::max(walk.probe, int64(1))) * 100.0, 1) << "% hits";
+      std::cout << " (" << ml::ftos(double(walk.probe) / double(evals) * 100.0, 1) << "% probed)" << std::endl;
+
+      std::cout << "  search: depth " << depth << ", " << node << " nodes";
+      std::cout << ", " << ml::ftos(time_search[0], 3) << " -> " << ml::ftos(time_search[1], 3) << "s";
+      std::cout << ", " << ml::ftos(double(search.hit) / double(std::max(search.probe, int64(1))) * 100.0, 1) << "% hits" << std::endl;
+   }
+
+   eval_cache(true);
+}
+
+void hub_io(int rounds) {
+
+   std::vector<Pos> ps = positions();
+   ps.insert(ps.begin(), pos::Start);
+
+   // typical requests: position, search limits and moves as sent by a GUI or server
+
+   std::vector<std::string> lines;
+   std::vector<std::pair<Pos, std::string>> moves;
+
+   for (const Pos & pos : ps) {
+
+      List list;
+      gen_moves(list, pos);
+
+      std::string line = "pos pos=" + pos_hub(pos) + " moves=\"";
+
+      for (int i = 0; i < list.size(); i++) {
+         std::string mv = move::to_hub(list[i], pos);
+         moves.push_back({pos, mv});
+         if (i != 0) line += " ";
+         line += mv;
+      }
+
+      line += "\"";
+
+      lines.push_back(line);
+      lines.push_back("level depth=12 nodes=1000000 move-time=0.5");
+      lines.push_back("go analyze");
+   }
+
+   int64 check = 0; // keeps the compiler honest
+
+   // parse
+
+   Timer timer;
+   timer.start();
+
+   for (int r = 0; r < rounds; r++) {
+
+      for (const std::string & line : lines) {
+
+         hub::Scanner scan(line);
+         check += scan.get_command().size();
+
+         while (!scan.eos()) {
+            hub::Pair p = scan.get_pair();
+            check += p.value.size();
+         }
+      }
+
+      for (const auto & mv : moves) {
+         if (move::from_hub(mv.second, mv.first) != move::None) check += 1;
+      }
+   }
+
+   timer.stop();
+   double time_parse = timer.elapsed();
+
+   // write
+
+   timer.reset();
+   timer.start();
+
+   for (int r = 0; r < rounds; r++) {
+
+      for (const Pos & pos : ps) {
+
+         List list;
+         gen_moves(list, pos);
+
+         Line pv;
+         Pos new_pos = pos;
+
+         for (int i = 0; i < 8 && !pos::is_end(new_pos); i++) {
+            Move mv = quick_move(new_pos);
+            pv.add(mv);
+            new_pos = new_pos.succ(mv);
+         }
+
+         std::string line = "info";
+         hub::add_pair(line, "depth", 12);
+         hub::add_pair(line, "score", ml::ftos(0.12, 2));
+         hub::add_pair(line, "nodes", int64(1234567));
+         hub::add_pair(line, "time", ml::ftos(0.532, 3));
+         hub::add_pair(line, "pv", pv.to_hub(pos));
+         check += line.size();
+
+         check += pos_hub(pos).size();
+
+         for (Move mv : list) {
+            check += move::to_hub(mv, pos).size();
+         }
+      }
+   }
+
+   timer.stop();
+   double time_write = timer.elapsed();
+
+   double n_parse = double(rounds) * double(lines.size() + moves.size());
+   double n_write = double(rounds) * double(ps.size());
+
+   std::cout << lines.size() << " lines, " << moves.size() << " moves, " << rounds << " rounds (check " << check << ")" << std::endl;
+   std::cout << "parse: " << ml::ftos(time_parse / n_parse * 1E9, 0) << " ns/item" << std::endl;
+   std::cout << "write: " << ml::ftos(time_write / n_write * 1E9, 0) << " ns/position (info line, position, moves)" << std::endl;
+}
+
+static int64 perft(const Pos & pos, Depth depth, bool count) {
+
+   assert(depth > 0);
+
+   if (count && depth == 1) return count_moves(pos);
+
+   List list;
+   gen_moves(list, pos);
+
+   if (depth == 1) return list.size();
+
+   int64 n = 0;
+
+   for (Move mv : list) {
+      n += perft(pos.succ(mv), Depth(depth - 1), count);
+   }
+
+   return n;
+}
+
+static std::vector<Pos> bb_positions(int size) { // uniform over slices, then over positions
+
+   std::vector<bb::ID> ids;
+
+   for (int i = 0; i < bb::ID_Size; i++) {
+
+      bb::ID id = bb::ID(i);
+
+      if (!bb::id_is_illegal(id) && !bb::id_is_end(id) && bb::id_size(id) <= var::BB_Size) {
+         ids.push_back(id);
+      }
+   }
+
+   std::vector<Pos> ps;
+
+   while (int(ps.size()) < size) {
+
+      bb::ID id = ids[ml::rand_int_64() % ids.size()];
+
+      Pos pos;
+      if (bb::index_to_pos(id, bb::Index(ml::rand_int_64() % bb::index_size(id)), pos)) ps.push_back(pos);
+   }
+
+   return ps;
+}
+
+static std::vector<Pos> endgame_positions(int size) { // random quiet positions with men and kings on both sides
+
+   std::vector<bb::ID> ids;
+
+   for (int i = 0; i < bb::ID_Size; i++) {
+
+      bb::ID id = bb::ID(i);
+
+      if (!bb::id_is_illegal(id) && bb::id_size(id) >= 7 && bb::id_size(id) <= 8
+       && bb::id_wm(id) >= 1 && bb::id_bm(id) >= 1 && bb::id_wk(id) >= 1 && bb::id_bk(id) >= 1) {
+         ids.push_back(id);
+      }
+   }
+
+   std::vector<Pos> ps;
+
+   while (int(ps.size()) < size) {
+
+      bb::ID id = ids[ml::rand_int_64() % ids.size()];
+
+      Pos pos;
+
+      if (bb::index_to_pos(id, bb::Index(ml::rand_int_64() % bb::index_size(id)), pos)
+       && !pos::is_end(pos) && !pos::is_capture(pos)) {
+         ps.push_back(pos);
+      }
+   }
+
+   return ps;
+}
+
+static int64 eval_walk(const Pos & pos, Depth depth, int64 & sum) {
+
+   sum += eval(pos);
+   if (depth == 0) return 1;
+
+   List list;
+   gen_moves(list, pos);
+
+   int64 n = 1;
+
+   for (Move mv : list) {
+      n += eval_walk(pos.succ(mv), Depth(depth - 1), sum);
+   }
+
+   return n;
+}
+
+static std::vector<Pos> positions() { // deterministic game from the start position
+
+   std::vector<Pos> ps;
+
+   Pos pos = pos::Start;
+
+   for (int ply = 0; ply < Game_Ply && !pos::is_end(pos); ply++) {
+
+      if (ply % Sample_Ply == Sample_Ply - 1) ps.push_back(pos);
+
+      G_TT.clear();
+      Search_Output so = search_depth(pos, Game_Depth);
+
+      Move mv = so.move;
+      if (mv == move::None) mv = quick_move(pos);
+
+      pos = pos.succ(mv);
+   }
+
+   return ps;
+}
+
+static Search_Output search_depth(const Pos & pos, Depth depth) {
+
+   Search_Input si;
+   si.move = false;
+   si.book = false;
+   si.depth = depth;
+   si.output = Output_None;
+
+   Search_Output so;
+   search(so, Node(pos), si);
+
+   return so;
+}
+
+static void write_json(std::ostream & stream, Depth depth, const std::vector<Pos> & ps, const std::vector<Run> & runs) {
+
+   const Run & base = runs[0];
+
+   stream << "{\n";
+   stream << "  \"variant\": \"" << var::get("variant") << "\",\n";
+   stream << "  \"depth\": " << depth << ",\n";
+
+   stream << "  \"positions\": [";
+
+   for (int i = 0; i < int(ps.size()); i++) {
+      if (i != 0) stream << ", ";
+      stream << "\"" << pos_hub(ps[i]) << "\"";
+   }
+
+   stream << "],\n";
+
+   stream << "  \"runs\": [\n";
+
+   for (int i = 0; i < int(runs.size()); i++) {
+
+      const Run & run = runs[i];
+
+      double nps = double(run.node) / std::max(run.time, 1E-6);
+      double base_nps = double(base.node) / std::max(base.time, 1E-6);
+
+      stream << "    {";
+      stream << "\"threads\": " << run.threads;
+      stream << ", \"time\": " << ml::ftos(run.time, 3);
+      stream << ", \"nodes\": " << run.node;
+      stream << ", \"nps\": " << int64(nps);
+      stream << ", \"speedup\": " << ml::ftos(base.time / std::max(run.time, 1E-6), 3);
+      stream << ", \"nps_scaling\": " << ml::ftos(nps / base_nps, 3);
+      stream << ", \"overhead\": " << ml::ftos(double(run.node) / double(base.node) - 1.0, 3);
+      stream << ", \"splits\": " << run.smp.split;
+      stream << ", \"joins\": " << run.smp.join;
+      stream << ", \"wait\": " << ml::ftos(run.smp.wait, 3);
+      stream << ", \"spin\": " << ml::ftos(run.smp.spin, 3);
+      stream << ", \"lock\": " << run.smp.lock;
+      stream << ", \"lock_wait\": " << run.smp.lock_wait;
+      stream << "}" << ((i + 1 < int(runs.size())) ? "," : "") << "\n";
+   }
+
+   stream << "  ]\n";
+   stream << "}\n";
+}
+
+} // namespace bench
+
@@ -0,0 +1,26 @@
+
+#ifndef BENCH_HPP
+#define BENCH_HPP
+
+// includes
+
+#include <string>
+
+#include "common.hpp"
+#include "libmy.hpp"
+
+namespace bench {
+
+// functions
+
+void smp (int threads, Depth depth, const std::string & file_name); // JSON report
+void bb  (int size); // probe latency, recursive QS vs capture-resolved slices
+
+void movegen (Depth depth); // perft with full lists vs count-only leaves
+void hub_io  (int rounds);  // protocol parsing and formatting throughput
+void eval    (Depth depth); // men-cache hit rates and eval speed, middlegame and endgame suites
+
+} // namespace bench
+
+#endif // !defined BENCH_HPP
+
@@ -35,6 +35,8 @@ inline int  bit (Bit b, Square sq) { return (b >> sq) & 1; }
 
 inline bool is_incl (Bit b0, Bit b1) { return (b0 & ~b1) == 0; }
 
+inline Bit opp (Bit b) { return Bit(ml::bit_reverse(uint64(b)) >> 1); } // square_opp() on every square (63 bits)
+
 inline void set   (Bit & b, Square sq) { b |=  bit(sq); }
 inline void clear (Bit & b, Square sq) { b &= ~bit(sq); }
 
@@ -6,14 +6,17 @@
 #include <fstream>
 #include <iostream>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 #include "book.hpp"
 #include "common.hpp"
+#include "embed.hpp"
 #include "gen.hpp"
 #include "hash.hpp"
 #include "libmy.hpp"
 #include "list.hpp"
+#include "logger.hpp"
 #include "move.hpp"
 #include "pos.hpp"
 #include "score.hpp"
@@ -64,7 +67,7 @@ static void backup ();
 static int  backup (const Pos & pos);
 
 static void load (const std::string & file_name);
-static void load (std::istream & file, const Pos & pos);
+static void load (std::istream & file, const Pos & pos, std::unordered_set<Key> & done);
 
 // functions
 
@@ -72,7 +75,7 @@ void init() {
 
    static_assert(sizeof(Entry) == 16, "");
 
-   std::cout << "init book" << std::endl;
+   logger::put(logger::Level::Info, "init book");
    G_Book.load(std::string("data/book") + var::variant_name());
 }
 
@@ -134,7 +137,7 @@ void Book::clear_done() {
 
 Entry * Book::find_entry(const Pos & pos, bool create) {
 
-   Key key = hash::key(pos);
+   Key key = var::Book_Canonical ? hash::canonical(pos) : hash::key(pos); // canonical: mirrored lines share entries
    if (key == Key_None) return nullptr;
 
    for (int index = hash::index(key, Hash_Mask); true; index = (index + 1) & Hash_Mask) {
@@ -189,24 +192,24 @@ static int backup(const Pos & pos) {
 
 static void load(const std::string & file_name) {
 
-   std::ifstream file(file_name);
+   embed::In_File file(file_name);
 
    if (!file) {
       std::cerr << "unable to open file \"" << file_name << "\"" << std::endl;
       std::exit(EXIT_FAILURE);
    }
 
-   G_Book.clear_done();
-   load(file, pos::Start);
+   std::unordered_set<Key> done; // raw keys: the file skips its own transpositions, not mirrored lines
+   load(file, pos::Start, done);
 }
 
-static void load(std::istream & file, const Pos & pos) {
+static void load(std::istream & file, const Pos & pos, std::unordered_set<Key> & done) {
+
+   if (!done.insert(hash::key(pos)).second) return;
 
    Entry * entry = G_Book.find_entry(pos, true);
    assert(entry != nullptr);
 
-   if (entry->done) return;
-
    bool node;
    file >> node;
 
@@ -217,13 +220,16 @@ static void load(std::istream & file, const Pos & pos) {
 
    if (!node) { // leaf
 
-      file >> entry->score;
+      int score;
+      file >> score;
 
       if (file.eof()) {
          std::cerr << "load(): EOF" << std::endl;
          std::exit(EXIT_FAILURE);
       }
 
+      if (!entry->node) entry->score = score; // a mirrored node wins, see backup()
+
    } else {
 
       entry->node = true;
@@ -233,11 +239,9 @@ static void load(std::istream & file, const Pos & pos) {
       list.sort_static(pos);
 
       for (Move mv : list) {
-         load(file, pos.succ(mv));
+         load(file, pos.succ(mv), done);
       }
    }
-
-   entry->done = true;
 }
 
 } // namespace book
@@ -0,0 +1,632 @@
+
+// includes
+
+#include <algorithm>
+#include <climits>
+#include <cstdio> // for perror
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "cluster.hpp"
+#include "common.hpp"
+#include "fen.hpp"
+#include "hub.hpp"
+#include "libmy.hpp"
+#include "logger.hpp"
+#include "pos.hpp"
+#include "score.hpp"
+#include "search.hpp"
+#include "socket.hpp"
+#include "thread.hpp"
+#include "tt.hpp"
+#include "util.hpp"
+#include "var.hpp"
+
+namespace cluster {
+
+// constants
+
+const int Buffer_Size {4096};
+
+const int Connect_Tries {60}; // one per second
+
+// types
+
+class Link { // one line-based connection
+
+private:
+
+   SOCKET m_socket {INVALID_SOCKET};
+   std::string m_buffer;
+
+   std::mutex m_write_mutex;
+
+   std::mutex m_mutex;
+   std::condition_variable m_cond;
+
+   std::atomic<bool> m_alive {false};
+
+   int m_id {0}; // last request
+   int m_result_id {-1};
+   Score m_score {score::None};
+   std::string m_pv;
+   int64 m_nodes {0};
+
+public:
+
+   void open  (SOCKET socket);
+   void close ();
+
+   bool read  (std::string & line);
+   void write (const std::string & line);
+
+   int  new_id     ();
+   void put_result (int id, Score score, const std::string & pv, int64 nodes);
+   bool get_result (int id, Score & score, std::string & pv, int64 & nodes);
+
+   bool is_alive () const { return m_alive; }
+};
+
+// variables
+
+static bool G_Active {false};
+
+static Link G_Link[Size_Max]; // coordinator: one per worker, worker: [0] = coordinator
+static int G_Size {0};
+
+static std::mutex G_Share_Mutex;
+static std::string G_Share; // pending TT lines
+
+// prototypes
+
+static void coord_input  (int worker);
+static void worker_input ();
+static void share_output ();
+
+static void worker_search (hub::Scanner & scan);
+
+static void store_entry (hub::Scanner & scan);
+
+static int    to_int    (const std::string & s);
+static int64  to_int64  (const std::string & s);
+static uint64 to_uint64 (const std::string & s);
+
+// functions
+
+void init() {
+
+   if (G_Active || var::Cluster_Workers == 0) return;
+
+   socket_::startup();
+
+   SOCKET listen_socket = socket_::listen(var::Cluster_Port, Size_Max);
+
+   int size = std::min(var::Cluster_Workers, Size_Max);
+
+   logger::put(logger::Level::Info, "waiting for " + std::to_string(size) + " cluster workers");
+
+   while (G_Size < size) {
+
+      SOCKET socket = accept(listen_socket, nullptr, nullptr);
+      if (socket == INVALID_SOCKET) {
+         std::perror("accept");
+         std::exit(EXIT_FAILURE);
+      }
+
+      Link & link = G_Link[G_Size];
+      link.open(socket);
+
+      // handshake
+
+      std::string line;
+      if (!link.read(line)) continue;
+
+      hub::Scanner scan(line);
+      std::string variant;
+
+      try {
+
+         if (scan.get_command() != "hello") throw Bad_Input();
+
+         while (!scan.eos()) {
+            auto p = scan.get_pair();
+            if (p.name == "variant") variant = p.value;
+         }
+
+      } catch (const Bad_Input &) {
+
+         std::cerr << "cluster: bad handshake \"" << line << "\"" << std::endl;
+         link.close();
+         continue;
+      }
+
+      if (variant != var::get("variant")) {
+         std::cerr << "cluster: worker variant \"" << variant << "\" differs" << std::endl;
+         link.close();
+         continue;
+      }
+
+      std::thread(coord_input, G_Size).detach();
+      G_Size += 1;
+   }
+
+   socket_::close(listen_socket);
+
+   std::thread(share_output).detach();
+   G_Active = true;
+
+   logger::put(logger::Level::Info, "cluster ready");
+}
+
+void loop() {
+
+   socket_::startup();
+
+   SOCKET socket = INVALID_SOCKET;
+
+   for (int i = 0; i < Connect_Tries && socket == INVALID_SOCKET; i++) {
+      if (i != 0) std::this_thread::sleep_for(std::chrono::seconds(1));
+      socket = socket_::open(var::Cluster_Host, var::Cluster_Port);
+   }
+
+   if (socket == INVALID_SOCKET) {
+      std::perror("connect");
+      std::exit(EXIT_FAILURE);
+   }
+
+   Link & link = G_Link[0];
+   link.open(socket);
+   G_Size = 1;
+
+   std::string hello = "hello";
+   hub::add_pair(hello, "variant", var::get("variant"));
+   link.write(hello);
+
+   logger::put(logger::Level::Info, "connected to coordinator");
+
+   std::thread(worker_input).detach();
+   std::thread(share_output).detach();
+   G_Active = true;
+
+   while (true) {
+
+      std::string line;
+      if (!get_line(line)) std::exit(EXIT_SUCCESS); // coordinator is gone
+
+      hub::Scanner scan(line);
+      if (scan.eos()) continue;
+
+      try {
+
+         std::string command = scan.get_command();
+
+         if (false) {
+         } else if (command == "search") {
+            worker_search(scan);
+         } else if (command == "new-game") {
+            G_TT.clear();
+         } else if (command == "stop") {
+            // no-op (search already finished)
+         } else if (command == "quit") {
+            std::exit(EXIT_SUCCESS);
+         }
+
+      } catch (const Bad_Input &) {
+
+         std::cerr << "cluster: bad command \"" << line << "\"" << std::endl;
+      }
+   }
+}
+
+static void worker_search(hub::Scanner & scan) {
+
+   std::string id;
+   std::string fen;
+   int depth = 1;
+
+   while (!scan.eos()) {
+
+      auto p = scan.get_pair();
+
+      if (false) {
+      } else if (p.name == "id") {
+         id = p.value;
+      } else if (p.name == "pos") {
+         fen = p.value;
+      } else if (p.name == "depth") {
+         depth = to_int(p.value);
+      }
+   }
+
+   Pos pos = pos_from_hub(fen);
+   Node node(pos);
+
+   Score sc;
+   std::string pv;
+   int64 nodes = 0;
+
+   if (pos::is_end(pos)) {
+
+      sc = (var::Variant == var::Losing) ? score::win(Ply_Root) : score::loss(Ply_Root);
+
+   } else {
+
+      Search_Input si;
+      si.move = false;
+      si.book = false;
+      si.depth = Depth(std::max(depth, 1));
+      si.input = true; // "stop" from the coordinator
+      si.output = Output_None;
+
+      Search_Output so;
+      search(so, node, si);
+
+      sc = so.score;
+      pv = so.pv.to_hub(pos);
+      nodes = so.node;
+   }
+
+   std::string line = "result";
+   hub::add_pair(line, "id", id);
+   hub::add_pair(line, "score", std::to_string(sc));
+   hub::add_pair(line, "nodes", std::to_string(nodes));
+   if (!pv.empty()) hub::add_pair(line, "pv", pv);
+   G_Link[0].write(line);
+}
+
+bool is_active() {
+   return G_Active;
+}
+
+int size() {
+   return G_Active ? G_Size : 0;
+}
+
+bool is_alive(int worker) {
+   assert(worker >= 0 && worker < G_Size);
+   return G_Link[worker].is_alive();
+}
+
+int request(int worker, const Pos & pos, Depth depth) {
+
+   assert(worker >= 0 && worker < G_Size);
+   Link & link = G_Link[worker];
+
+   int id = link.new_id();
+
+   std::string line = "search";
+   hub::add_pair(line, "id", std::to_string(id));
+   hub::add_pair(line, "pos", pos_hub(pos));
+   hub::add_pair(line, "depth", std::to_string(depth));
+   link.write(line);
+
+   return id;
+}
+
+bool result(int worker, int id, Score & score, std::string & pv, int64 & nodes) {
+   assert(worker >= 0 && worker < G_Size);
+   return G_Link[worker].get_result(id, score, pv, nodes);
+}
+
+void cancel(int worker) {
+   assert(worker >= 0 && worker < G_Size);
+   G_Link[worker].write("stop");
+}
+
+void share(Key key, Move_Index move, Score score, Flag flag, Depth depth) {
+
+   if (!G_Active) return;
+
+   std::string line = "tt";
+   hub::add_pair(line, "key", std::to_string(uint64(key)));
+   hub::add_pair(line, "move", std::to_string(move));
+   hub::add_pair(line, "score", std::to_string(score));
+   hub::add_pair(line, "flag", std::to_string(int(flag)));
+   hub::add_pair(line, "depth", std::to_string(depth));
+
+   std::lock_guard<std::mutex> lock(G_Share_Mutex);
+   G_Share += line;
+   G_Share += '\n';
+}
+
+void new_game() {
+
+   if (!G_Active) return;
+
+   for (int i = 0; i < G_Size; i++) {
+      if (G_Link[i].is_alive()) G_Link[i].write("new-game");
+   }
+}
+
+static void coord_input(int worker) {
+
+   Link & link = G_Link[worker];
+
+   std::string line;
+
+   while (link.read(line)) {
+
+      hub::Scanner scan(line);
+      if (scan.eos()) continue;
+
+      try {
+
+         std::string command = scan.get_command();
+
+         if (false) {
+
+         } else if (command == "result") {
+
+            int id = -1;
+            Score sc = score::None;
+            std::string pv;
+            int64 nodes = 0;
+
+            while (!scan.eos()) {
+
+               auto p = scan.get_pair();
+
+               if (false) {
+               } else if (p.name == "id") {
+                  id = to_int(p.value);
+               } else if (p.name == "score") {
+                  sc = Score(to_int(p.value));
+               } else if (p.name == "nodes") {
+                  nodes = to_int64(p.value);
+               } else if (p.name == "pv") {
+                  pv = p.value;
+               }
+            }
+
+            if (score::is_ok(sc)) link.put_result(id, sc, pv, nodes); // None if aborted
+
+         } else if (command == "tt") {
+
+            store_entry(scan);
+
+            for (int i = 0; i < G_Size; i++) { // forward to the other workers
+               if (i != worker && G_Link[i].is_alive()) G_Link[i].write(line);
+            }
+         }
+
+      } catch (const Bad_Input &) {
+
+         logger::put(logger::Level::Error, "cluster: bad message \"" + line + "\"");
+      }
+   }
+
+   logger::put(logger::Level::Error, "cluster: worker " + std::to_string(worker) + " disconnected");
+}
+
+static void worker_input() {
+
+   Link & link = G_Link[0];
+
+   std::string line;
+
+   while (link.read(line)) {
+
+      if (line.compare(0, 3, "tt ") == 0) { // TT entries bypass the command queue
+
+         hub::Scanner scan(line);
+
+         try {
+            scan.get_command();
+            store_entry(scan);
+         } catch (const Bad_Input &) {
+            logger::put(logger::Level::Error, "cluster: bad message \"" + line + "\"");
+         }
+
+      } else {
+
+         put_line(line);
+      }
+   }
+
+   put_eof();
+}
+
+static void share_output() {
+
+   while (true) {
+
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+      std::string lines;
+
+      {
+         std::lock_guard<std::mutex> lock(G_Share_Mutex);
+         lines.swap(G_Share);
+      }
+
+      if (lines.empty()) continue;
+
+      lines.pop_back(); // last '\n' is added by write()
+
+      for (int i = 0; i < G_Size; i++) {
+         if (G_Link[i].is_alive()) G_Link[i].write(lines);
+      }
+   }
+}
+
+static void store_entry(hub::Scanner & scan) {
+
+   Key key {};
+   int move = Move_Index_None;
+   int sc = score::None;
+   int flag = int(Flag::None);
+   int depth = 0;
+
+   while (!scan.eos()) {
+
+      auto p = scan.get_pair();
+
+      if (false) {
+      } else if (p.name == "key") {
+         key = Key(to_uint64(p.value));
+      } else if (p.name == "move") {
+         move = to_int(p.value);
+      } else if (p.name == "score") {
+         sc = to_int(p.value);
+      } else if (p.name == "flag") {
+         flag = to_int(p.value);
+      } else if (p.name == "depth") {
+         depth = to_int(p.value);
+      }
+   }
+
+   if (move < 0 || move >= Move_Index_Size
+    || !score::is_ok(sc)
+    || flag < 0 || flag > int(Flag::Exact)
+    || depth <= 0 || depth > Depth_Max
+    ) {
+      throw Bad_Input();
+   }
+
+   G_TT.store(key, Move_Index(move), Score(sc), Flag(flag), Depth(depth));
+}
+
+void Link::open(SOCKET socket) {
+   m_socket = socket;
+   m_buffer.clear();
+   m_alive = true;
+}
+
+void Link::close() {
+
+   if (m_socket != INVALID_SOCKET) socket_::close(m_socket);
+
+   m_socket = INVALID_SOCKET;
+   m_alive = false;
+
+   m_cond.notify_all();
+}
+
+bool Link::read(std::string & line) {
+
+   while (true) {
+
+      auto i = m_buffer.find('\n');
+
+      if (i != std::string::npos) {
+         line = m_buffer.substr(0, i);
+         m_buffer.erase(0, i + 1);
+         return true;
+      }
+
+      char buffer[Buffer_Size];
+      int len = recv(m_socket, buffer, Buffer_Size, 0);
+
+      if (len <= 0) { // EOF or error
+         close();
+         return false;
+      }
+
+      m_buffer.append(buffer, len);
+   }
+}
+
+void Link::write(const std::string & line) {
+
+   std::lock_guard<std::mutex> lock(m_write_mutex);
+
+   if (!m_alive) return;
+
+   std::string s = line + "\n";
+
+   for (int i = 0; i < int(s.size());) {
+
+      int len = send(m_socket, &s[i], int(s.size()) - i, 0);
+
+      if (len <= 0) { // error
+         std::perror("send");
+         m_alive = false;
+         m_cond.notify_all();
+         return;
+      }
+
+      i += len;
+   }
+}
+
+int Link::new_id() {
+   std::lock_guard<std::mutex> lock(m_mutex);
+   return ++m_id;
+}
+
+void Link::put_result(int id, Score score, const std::string & pv, int64 nodes) {
+
+   std::lock_guard<std::mutex> lock(m_mutex);
+
+   if (id != m_id) return; // cancelled request
+
+   m_result_id = id;
+   m_score = score;
+   m_pv = pv;
+   m_nodes = nodes;
+
+   m_cond.notify_all();
+}
+
+bool Link::get_result(int id, Score & score, std::string & pv, int64 & nodes) {
+
+   std::unique_lock<std::mutex> lock(m_mutex);
+
+   if (m_result_id != id) { // wait a little; caller polls for stop in between
+      m_cond.wait_for(lock, std::chrono::milliseconds(1));
+      if (m_result_id != id) return false;
+   }
+
+   score = m_score;
+   pv = m_pv;
+   nodes = m_nodes;
+
+   return true;
+}
+
+static int to_int(const std::string & s) {
+
+   int64 n = to_int64(s);
+   if (n < INT_MIN || n > INT_MAX) throw Bad_Input();
+
+   return int(n);
+}
+
+static int64 to_int64(const std::string & s) { // peer input: Bad_Input rather than std::terminate in a reader thread
+
+   std::size_t end = 0;
+   int64 n = 0;
+
+   try {
+      n = std::stoll(s, &end);
+   } catch (const std::logic_error &) { // invalid_argument or out_of_range
+      throw Bad_Input();
+   }
+
+   if (end != s.size()) throw Bad_Input();
+
+   return n;
+}
+
+static uint64 to_uint64(const std::string & s) {
+
+   if (!string_is_nat(s)) throw Bad_Input(); // stoull accepts a sign
+
+   try {
+      return std::stoull(s);
+   } catch (const std::logic_error &) {
+      throw Bad_Input();
+   }
+}
+
+} // namespace cluster
+
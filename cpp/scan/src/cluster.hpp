@@ -0,0 +1,43 @@
+
+#ifndef CLUSTER_HPP
+#define CLUSTER_HPP
+
+// includes
+
+#include <string>
+
+#include "common.hpp"
+#include "libmy.hpp"
+#include "tt.hpp" // for Flag
+
+class Pos;
+
+namespace cluster {
+
+// constants
+
+const int Size_Max {16}; // workers
+
+const Depth Split_Depth {Depth(6)};  // root depth before workers are used
+const Depth Share_Depth {Depth(10)}; // TT entries shared between processes
+
+// functions
+
+void init (); // coordinator: waits for the workers
+void loop (); // worker
+
+bool is_active ();
+int  size      ();
+bool is_alive  (int worker);
+
+int  request (int worker, const Pos & pos, Depth depth);
+bool result  (int worker, int id, Score & score, std::string & pv, int64 & nodes);
+void cancel  (int worker);
+
+void share    (Key key, Move_Index move, Score score, Flag flag, Depth depth);
+void new_game ();
+
+} // namespace cluster
+
+#endif // !defined CLUSTER_HPP
+
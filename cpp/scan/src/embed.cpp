@@ -0,0 +1,121 @@
+
+// includes
+
+#include <fstream>
+#include <string>
+
+#include "embed.hpp"
+#include "libmy.hpp"
+
+// macros
+
+// "embed_data.inc" is generated by "make EMBED=1" (or the podspec with SCAN_EMBED_DATA=1)
+// one line per file: EMBED(<n>, "<name>", "<absolute path>")
+
+#ifdef SCAN_EMBED
+
+#if defined __APPLE__
+#define EMBED_SECTION ".const_data"
+#define EMBED_SYMBOL(n) "_embed_image_" #n
+#else
+#define EMBED_SECTION ".section .rodata"
+#define EMBED_SYMBOL(n) "embed_image_" #n
+#endif
+
+#define EMBED(n, name, path) \
+   __asm__( \
+      EMBED_SECTION "\n" \
+      ".global " EMBED_SYMBOL(n) "\n" \
+      ".balign 16\n" \
+      EMBED_SYMBOL(n) ":\n" \
+      ".incbin \"" path "\"\n" \
+      ".global " EMBED_SYMBOL(n) "_end\n" \
+      EMBED_SYMBOL(n) "_end:\n" \
+      ".byte 0\n" \
+      ".text\n" \
+   ); \
+   extern "C" const uint8 embed_image_##n[]; \
+   extern "C" const uint8 embed_image_##n##_end[];
+
+#include "embed_data.inc"
+
+#undef EMBED
+
+#endif
+
+namespace embed {
+
+// variables
+
+static const Image G_Image[] {
+
+#ifdef SCAN_EMBED
+#define EMBED(n, name, path) { name, embed_image_##n, int64(embed_image_##n##_end - embed_image_##n) },
+#include "embed_data.inc"
+#undef EMBED
+#endif
+
+   { nullptr, nullptr, 0 }, // sentinel
+};
+
+// functions
+
+const Image * find(const std::string & file_name) {
+
+   for (const Image * image = &G_Image[0]; image->name != nullptr; image++) {
+      if (file_name == image->name) return image;
+   }
+
+   return nullptr;
+}
+
+bool has_file(const std::string & file_name) {
+   return find(file_name) != nullptr || std::ifstream(file_name);
+}
+
+void Mem_Buf::set(const uint8 * data, int64 size) {
+   char * begin = const_cast<char *>(reinterpret_cast<const char *>(data)); // never written through
+   setg(begin, begin, begin + size);
+}
+
+Mem_Buf::pos_type Mem_Buf::seekoff(off_type off, std::ios::seekdir dir, std::ios::openmode which) {
+
+   if ((which & std::ios::in) == 0) return pos_type(off_type(-1));
+
+   off_type base;
+
+   if (dir == std::ios::beg) {
+      base = 0;
+   } else if (dir == std::ios::cur) {
+      base = gptr() - eback();
+   } else {
+      base = egptr() - eback();
+   }
+
+   off_type pos = base + off;
+   if (pos < 0 || pos > egptr() - eback()) return pos_type(off_type(-1));
+
+   setg(eback(), eback() + pos, egptr());
+   return pos_type(pos);
+}
+
+Mem_Buf::pos_type Mem_Buf::seekpos(pos_type pos, std::ios::openmode which) {
+   return seekoff(off_type(pos), std::ios::beg, which);
+}
+
+In_File::In_File(const std::string & file_name) : std::istream(nullptr) {
+
+   const Image * image = find(file_name);
+
+   if (image != nullptr) {
+      m_mem.set(image->data, image->size);
+      rdbuf(&m_mem);
+   } else if (m_file.open(file_name, std::ios::in | std::ios::binary) != nullptr) {
+      rdbuf(&m_file);
+   } else {
+      setstate(std::ios::failbit);
+   }
+}
+
+} // namespace embed
+
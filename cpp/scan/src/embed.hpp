@@ -0,0 +1,57 @@
+
+#ifndef EMBED_HPP
+#define EMBED_HPP
+
+// includes
+
+#include <fstream>
+#include <istream>
+#include <streambuf>
+#include <string>
+
+#include "libmy.hpp"
+
+namespace embed {
+
+// types
+
+struct Image { // a data file linked into the binary, see "make EMBED=1"
+   const char * name; // as opened by the engine, e.g. "data/eval"
+   const uint8 * data;
+   int64 size;
+};
+
+class Mem_Buf : public std::streambuf { // read-only view of an image
+
+public:
+
+   void set (const uint8 * data, int64 size);
+
+protected:
+
+   pos_type seekoff (off_type off, std::ios::seekdir dir, std::ios::openmode which) override;
+   pos_type seekpos (pos_type pos, std::ios::openmode which) override;
+};
+
+class In_File : public std::istream { // std::ifstream that looks at the linked images first
+
+private:
+
+   std::filebuf m_file;
+   Mem_Buf m_mem;
+
+public:
+
+   explicit In_File (const std::string & file_name);
+};
+
+// functions
+
+const Image * find (const std::string & file_name); // nullptr if not linked in
+
+bool has_file (const std::string & file_name); // linked in or on disk
+
+} // namespace embed
+
+#endif // !defined EMBED_HPP
+
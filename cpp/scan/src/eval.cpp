@@ -2,6 +2,7 @@
 // includes
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <cstdlib>
 #include <fstream>
@@ -11,8 +12,11 @@
 
 #include "bit.hpp"
 #include "common.hpp"
+#include "embed.hpp"
 #include "eval.hpp"
+#include "hash.hpp"
 #include "libmy.hpp"
+#include "logger.hpp"
 #include "pos.hpp"
 #include "score.hpp"
 #include "var.hpp"
@@ -24,9 +28,19 @@ constexpr int pow(int a, int b) { return (b == 0) ? 1 : pow(a, b - 1) * a; }
 // constants
 
 const int Pattern_Size {12}; // squares per pattern
+const int Pst_Var {3};
+const int Mob_Var {Pst_Var + Dense_Size};
+const int Skew_Var {Mob_Var + 2};
+const int Pattern_Var {Skew_Var + 1}; // first pattern weight
+const int Pattern_Weights {pow(3, Pattern_Size)}; // per region
 const int P {2125820}; // eval parameters
 const int Unit {10}; // units per cp
 
+const int Men_Bit {14}; // men-cache entries
+const int Men_Size {1 << Men_Bit};
+const int Men_Max {1 << 23}; // bound on |mg| and |eg| to fit an entry
+const uint64 Men_Valid {uint64(1) << 63};
+
 // "constants"
 
 const int Perm_0[Pattern_Size] { 11, 10,  7,  6,  3,  2,  9,  8,  5,  4,  1,  0 };
@@ -36,11 +50,19 @@ const int Perm_1[Pattern_Size] {  0,  1,  4,  5,  8,  9,  2,  3,  6,  7, 10, 11
 
 static std::vector<int> G_Weight;
 
+static int G_Trit[Pattern_Size]; // trit remapping from the ".perm" file
+static std::vector<uint32> G_Count; // pattern-weight profile (empty = off)
+
 static int Trits_0[pow(2, Pattern_Size)];
 static int Trits_1[pow(2, Pattern_Size)];
 
 // types
 
+struct Men_Entry { // lockless, check = key ^ data
+   std::atomic<uint64> check;
+   std::atomic<uint64> data; // mg (24 bits), eg (24 bits), stage (9 bits), valid
+};
+
 class Score_2 {
 
 private:
@@ -55,14 +77,48 @@ public:
       m_eg += G_Weight[var * 2 + 1] * val;
    }
 
+   void add(const Score_2 & s2) {
+      m_mg += s2.m_mg;
+      m_eg += s2.m_eg;
+   }
+
+   uint64 pack() const {
+      return uint64(m_mg + Men_Max) | (uint64(m_eg + Men_Max) << 24);
+   }
+
+   void unpack(uint64 data) {
+      m_mg = int(data & 0xFFFFFF) - Men_Max;
+      m_eg = int((data >> 24) & 0xFFFFFF) - Men_Max;
+   }
+
    int mg () const { return m_mg; }
    int eg () const { return m_eg; }
 };
 
+// variables
+
+// partial sums of the men-only terms, shared by all threads
+
+static Men_Entry G_Men[Men_Size];
+static bool G_Men_On {true};
+
+static Eval_Stats G_Stats; // (not thread safe)
+static bool G_Stats_On {false};
+
 // prototypes
 
 static int conv (int index, int size, int bf, int bt, const int perm[]);
 
+static void load_trits (const std::string & file_name);
+static void find_trits (int trit[]);
+
+static int  trits_remap  (int index, const int trit[]);
+static void trits_digits (int index, int digit[]);
+static int  trits_lines  (const int trit[], double frac);
+
+static void men       (Score_2 & s2, int & stage, const Pos & pos);
+static void men_terms (Score_2 & s2, const Pos & pos);
+
 static void pst      (Score_2 & s2, int var, Bit bw, Bit bb);
 static void king_mob (Score_2 & s2, int var, const Pos & pos);
 static void pattern  (Score_2 & s2, int var, const Pos & pos);
@@ -76,12 +132,12 @@ static Bit attacks (const Pos & pos, Side sd);
 
 void eval_init() {
 
-   std::cout << "init eval" << std::endl;
+   logger::put(logger::Level::Info, "init eval");
 
    // load weights
 
    std::string file_name = std::string("data/eval") + var::variant_name();
-   std::ifstream file(file_name, std::ios::binary);
+   embed::In_File file(file_name);
 
    if (!file) {
       std::cerr << "unable to open file \"" << file_name << "\"" << std::endl;
@@ -94,15 +150,75 @@ void eval_init() {
       G_Weight[i] = int16(ml::get_bytes(file, 2)); // HACK: extend sign
    }
 
+   load_trits(file_name + ".perm"); // optional, see eval_profile_save()
+
+   eval_cache_clear(); // entries depend on the weights
+
    // init base conversion (2 -> 3)
 
+   int perm_0[Pattern_Size];
+   int perm_1[Pattern_Size];
+
+   for (int i = 0; i < Pattern_Size; i++) {
+      perm_0[i] = G_Trit[Perm_0[i]];
+      perm_1[i] = G_Trit[Perm_1[i]];
+   }
+
    int size = Pattern_Size;
    int bf = 2;
    int bt = 3;
 
    for (int i = 0; i < pow(bf, size); i++) {
-      Trits_0[i] = conv(i, size, bf, bt, Perm_0);
-      Trits_1[i] = conv(i, size, bf, bt, Perm_1);
+      Trits_0[i] = conv(i, size, bf, bt, perm_0);
+      Trits_1[i] = conv(i, size, bf, bt, perm_1);
+   }
+}
+
+void eval_cache_clear() {
+
+   for (Men_Entry & entry : G_Men) {
+      entry.check.store(0, std::memory_order_relaxed);
+      entry.data.store(0, std::memory_order_relaxed);
+   }
+}
+
+void eval_cache(bool on) {
+   G_Men_On = on;
+}
+
+void eval_stats_start() {
+   G_Stats = Eval_Stats();
+   G_Stats_On = true;
+}
+
+Eval_Stats eval_stats_stop() {
+   G_Stats_On = false;
+   return G_Stats;
+}
+
+static void load_trits(const std::string & file_name) {
+
+   for (int i = 0; i < Pattern_Size; i++) {
+      G_Trit[i] = i; // identity
+   }
+
+   embed::In_File file(file_name);
+   if (!file) return;
+
+   bool used[Pattern_Size] {};
+
+   for (int i = 0; i < Pattern_Size; i++) {
+
+      int trit = -1;
+      file >> trit;
+
+      if (trit < 0 || trit >= Pattern_Size || used[trit]) {
+         std::cerr << "bad permutation in file \"" << file_name << "\"" << std::endl;
+         std::exit(EXIT_FAILURE);
+      }
+
+      G_Trit[i] = trit;
+      used[trit] = true;
    }
 }
 
@@ -136,46 +252,26 @@ Score eval(const Pos & pos) {
    // features
 
    Score_2 s2;
-   int var = 0;
 
-   // material
+   // men structure: material, left/right balance, patterns and game phase
+
+   int stage;
+   men(s2, stage, pos);
+
+   assert(stage >= 0 && stage <= Stage_Size);
+
+   // kings
 
    int nwm = bit::count(pos.wm());
    int nbm = bit::count(pos.bm());
    int nwk = bit::count(pos.wk());
    int nbk = bit::count(pos.bk());
 
-   s2.add(var + 0, nwm - nbm);
-   s2.add(var + 1, (nwk >= 1) - (nbk >= 1));
-   s2.add(var + 2, std::max(nwk - 1, 0) - std::max(nbk - 1, 0));
-   var += 3;
-
-   // king position
-
-   pst(s2, var, pos.wk(), pos.bk());
-   var += Dense_Size;
-
-   // king mobility
-
-   king_mob(s2, var, pos);
-   var += 2;
-
-   // left/right balance
-
-   if (var::Variant != var::Losing) {
-      s2.add(var, std::abs(pos::skew(pos, White)) - std::abs(pos::skew(pos, Black)));
-   }
-   var += 1;
-
-   // patterns
-
-   pattern(s2, var, pos);
-   var += pow(3, Pattern_Size) * 4;
-
-   // game phase
+   s2.add(1, (nwk >= 1) - (nbk >= 1));
+   s2.add(2, std::max(nwk - 1, 0) - std::max(nbk - 1, 0));
 
-   int stage = pos::stage(pos);
-   assert(stage >= 0 && stage <= Stage_Size);
+   pst(s2, Pst_Var, pos.wk(), pos.bk());
+   king_mob(s2, Mob_Var, pos);
 
    int sc = ml::div_round(s2.mg() * (Stage_Size - stage) + s2.eg() * stage, Unit * Stage_Size);
 
@@ -211,6 +307,266 @@ Score eval(const Pos & pos) {
    return score::clamp(score::side(Score(sc), pos.turn())); // for side to move
 }
 
+static void men(Score_2 & s2, int & stage, const Pos & pos) { // cached by men configuration
+
+   // without kings nearly every move changes the men, the key would cost more than it saves
+
+   if (!G_Men_On || (pos.wk() | pos.bk()) == 0 || !G_Count.empty()) { // profiling needs every pattern lookup
+      men_terms(s2, pos);
+      stage = pos::stage(pos);
+      return;
+   }
+
+   uint64 key = uint64(hash::key_men(pos));
+   Men_Entry & entry = G_Men[hash::index(Key(key), Men_Size - 1)];
+
+   uint64 check = entry.check.load(std::memory_order_relaxed);
+   uint64 data  = entry.data.load(std::memory_order_relaxed);
+
+   if (G_Stats_On) G_Stats.probe += 1;
+
+   if ((data & Men_Valid) != 0 && (check ^ data) == key) { // hit
+
+      if (G_Stats_On) G_Stats.hit += 1;
+
+      Score_2 ms;
+      ms.unpack(data);
+      s2.add(ms);
+
+      stage = int((data >> 48) & 0x1FF);
+      return;
+   }
+
+   Score_2 ms;
+   men_terms(ms, pos);
+   stage = pos::stage(pos);
+
+   s2.add(ms);
+
+   if (std::abs(ms.mg()) < Men_Max && std::abs(ms.eg()) < Men_Max) {
+      data = ms.pack() | (uint64(stage) << 48) | Men_Valid;
+      entry.data.store(data, std::memory_order_relaxed);
+      entry.check.store(key ^ data, std::memory_order_relaxed);
+   }
+}
+
+static void men_terms(Score_2 & s2, const Pos & pos) {
+
+   // material
+
+   s2.add(0, bit::count(pos.wm()) - bit::count(pos.bm()));
+
+   // left/right balance
+
+   if (var::Variant != var::Losing) {
+      s2.add(Skew_Var, std::abs(pos::skew(pos, White)) - std::abs(pos::skew(pos, Black)));
+   }
+
+   // patterns
+
+   pattern(s2, Pattern_Var, pos);
+}
+
+void eval_profile_start() {
+   G_Count.assign(Pattern_Weights * 4, 0);
+}
+
+void eval_profile_save(const std::string & file_name) {
+
+   assert(!G_Count.empty());
+
+   int trit[Pattern_Size];
+   find_trits(trit);
+
+   int identity[Pattern_Size];
+
+   for (int i = 0; i < Pattern_Size; i++) {
+      identity[i] = i;
+   }
+
+   std::cout << "cache lines for 90% of pattern lookups: "
+             << trits_lines(identity, 0.9) << " -> " << trits_lines(trit, 0.9) << std::endl;
+
+   // weights
+
+   std::ofstream file(file_name, std::ios::binary);
+
+   if (!file) {
+      std::cerr << "unable to open file \"" << file_name << "\"" << std::endl;
+      std::exit(EXIT_FAILURE);
+   }
+
+   std::vector<int> weight = G_Weight;
+
+   for (int region = 0; region < 4; region++) {
+
+      int base = Pattern_Var + region * Pattern_Weights;
+
+      for (int index = 0; index < Pattern_Weights; index++) {
+
+         int var = base + trits_remap(index, trit);
+
+         weight[var * 2 + 0] = G_Weight[(base + index) * 2 + 0];
+         weight[var * 2 + 1] = G_Weight[(base + index) * 2 + 1];
+      }
+   }
+
+   for (int i = 0; i < P * 2; i++) {
+      ml::put_bytes(file, uint16(weight[i]), 2);
+   }
+
+   // permutation (composed with the one currently loaded)
+
+   std::ofstream perm(file_name + ".perm");
+
+   for (int i = 0; i < Pattern_Size; i++) {
+      if (i != 0) perm << ' ';
+      perm << trit[G_Trit[i]];
+   }
+
+   perm << '\n';
+
+   G_Count.clear();
+}
+
+static void find_trits(int trit[]) {
+
+   // merge regions, all four share the same base conversion
+
+   std::vector<double> count(Pattern_Weights, 0.0);
+
+   for (int i = 0; i < int(G_Count.size()); i++) {
+      count[i % Pattern_Weights] += double(G_Count[i]);
+   }
+
+   struct Entry {
+      int digit[Pattern_Size];
+      double count;
+   };
+
+   std::vector<Entry> entries;
+
+   for (int index = 0; index < Pattern_Weights; index++) {
+      if (count[index] == 0.0) continue;
+      Entry entry;
+      trits_digits(index, entry.digit);
+      entry.count = count[index];
+      entries.push_back(entry);
+   }
+
+   // greedy: the high-order trits should take as few values as possible
+
+   bool done[Pattern_Size] {};
+   int order[Pattern_Size]; // from high to low
+   std::vector<double> dist;
+
+   for (int pos = 0; pos < Pattern_Size; pos++) {
+
+      int best_i = -1;
+      double best_h = 1E30;
+
+      for (int i = 0; i < Pattern_Size; i++) {
+
+         if (done[i]) continue;
+
+         order[pos] = i;
+         dist.assign(pow(3, pos + 1), 0.0);
+
+         double total = 0.0;
+
+         for (const Entry & entry : entries) {
+
+            int key = 0;
+
+            for (int j = 0; j <= pos; j++) {
+               key = key * 3 + entry.digit[order[j]];
+            }
+
+            dist[key] += entry.count;
+            total += entry.count;
+         }
+
+         double h = 0.0;
+
+         for (double n : dist) {
+            if (n != 0.0) h -= n / total * std::log(n / total);
+         }
+
+         if (h < best_h) {
+            best_i = i;
+            best_h = h;
+         }
+      }
+
+      assert(best_i >= 0);
+      order[pos] = best_i;
+      done[best_i] = true;
+   }
+
+   for (int pos = 0; pos < Pattern_Size; pos++) {
+      trit[order[pos]] = (Pattern_Size - 1) - pos;
+   }
+}
+
+static int trits_remap(int index, const int trit[]) { // index in [0, 3^size)
+
+   int digit[Pattern_Size];
+   trits_digits(index, digit);
+
+   int to = 0;
+
+   for (int i = 0; i < Pattern_Size; i++) {
+      to += (digit[i] - 1) * pow(3, trit[i]);
+   }
+
+   return to + (Pattern_Weights - 1) / 2;
+}
+
+static void trits_digits(int index, int digit[]) { // balanced trits + 1
+
+   int x = index - (Pattern_Weights - 1) / 2;
+
+   for (int i = 0; i < Pattern_Size; i++) {
+
+      int d = ((x % 3) + 3) % 3;
+      if (d == 2) d = -1;
+
+      digit[i] = d + 1;
+      x = (x - d) / 3;
+   }
+
+   assert(x == 0);
+}
+
+static int trits_lines(const int trit[], double frac) {
+
+   const int Line_Vars {64 / (sizeof(int) * 2)}; // mg + eg
+
+   std::vector<double> line((Pattern_Var + Pattern_Weights * 4) / Line_Vars + 1, 0.0);
+   double total = 0.0;
+
+   for (int i = 0; i < int(G_Count.size()); i++) {
+
+      if (G_Count[i] == 0) continue;
+
+      int region = i / Pattern_Weights;
+      int var = Pattern_Var + region * Pattern_Weights + trits_remap(i % Pattern_Weights, trit);
+
+      line[var / Line_Vars] += double(G_Count[i]);
+      total += double(G_Count[i]);
+   }
+
+   std::sort(line.begin(), line.end(), [](double a, double b) { return a > b; });
+
+   int size = 0;
+
+   for (double sum = 0.0; size < int(line.size()) && sum < total * frac; size++) {
+      sum += line[size];
+   }
+
+   return size;
+}
+
 static void pst(Score_2 & s2, int var, Bit bw, Bit bb) {
 
    for (Square sq : bw) {
@@ -269,6 +625,8 @@ static void king_mob(Score_2 & s2, int var, const Pos & pos) {
 
 static void pattern(Score_2 & s2, int var, const Pos & pos) {
 
+   assert(var == Pattern_Var);
+
    int i0, i1, i2, i3; // top
    int i4, i5, i6, i7; // bottom
 
@@ -277,6 +635,17 @@ static void pattern(Score_2 & s2, int var, const Pos & pos) {
    indices_column(pos.wm() >> 2, pos.bm() >> 2, i2, i6);
    indices_column(pos.wm() >> 3, pos.bm() >> 3, i3, i7);
 
+   if (!G_Count.empty()) { // profiling (not thread safe)
+      G_Count[ 265720 + i0]++;
+      G_Count[ 797161 + i1]++;
+      G_Count[1328602 + i2]++;
+      G_Count[1860043 + i3]++;
+      G_Count[1860043 - i4]++;
+      G_Count[1328602 - i5]++;
+      G_Count[ 797161 - i6]++;
+      G_Count[ 265720 - i7]++;
+   }
+
    s2.add(var +  265720 + i0, +1);
    s2.add(var +  797161 + i1, +1);
    s2.add(var + 1328602 + i2, +1);
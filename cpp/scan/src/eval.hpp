@@ -4,15 +4,33 @@
 
 // includes
 
+#include <string>
+
 #include "common.hpp"
 #include "libmy.hpp"
 
 class Pos;
 
+// types
+
+struct Eval_Stats {
+   int64 probe {0}; // men-cache lookups
+   int64 hit {0};
+};
+
 // functions
 
 void eval_init ();
 
+void eval_cache_clear ();
+void eval_cache       (bool on); // men cache on/off, for benchmarking
+
+void       eval_stats_start (); // counting is not thread safe
+Eval_Stats eval_stats_stop  ();
+
+void eval_profile_start ();
+void eval_profile_save  (const std::string & file_name); // also writes "<file_name>.perm"
+
 Score eval (const Pos & pos);
 
 #endif // !defined EVAL_HPP
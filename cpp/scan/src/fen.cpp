@@ -260,6 +260,7 @@ static std::string pos_string(const Pos & pos, const std::string & sides, const
    assert(pieces.size() == Piece_Side_Size + 1);
 
    std::string s;
+   s.reserve(Dense_Size + 1);
 
    s += sides[pos.turn()];
 
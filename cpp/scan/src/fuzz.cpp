@@ -0,0 +1,491 @@
+
+// includes
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bb_base.hpp"
+#include "bit.hpp"
+#include "common.hpp"
+#include "eval.hpp"
+#include "fen.hpp"
+#include "fuzz.hpp"
+#include "gen.hpp"
+#include "hash.hpp"
+#include "libmy.hpp"
+#include "list.hpp"
+#include "move.hpp"
+#include "pos.hpp"
+#include "util.hpp"
+#include "var.hpp"
+
+namespace fuzz {
+
+// constants
+
+const int Ply_Max {300}; // per random walk
+const int Fail_Max {10}; // reports per check
+
+// types
+
+enum Check : int {
+   Check_Key,
+   Check_Gen,
+   Check_Eval,
+   Check_BB,
+   Check_FEN,
+   Check_Size,
+};
+
+class Worker {
+
+public:
+
+   std::mt19937_64 rand;
+   int64 count[Check_Size] {};
+   int64 fail[Check_Size] {};
+   int64 pos {0};
+};
+
+// "constants"
+
+const std::string Check_Name[Check_Size] { "key", "gen", "eval", "bb", "fen" };
+
+const int Dir_File[Dir_Size] { -1, +1, -1, +1, -2, +2,  0,  0 };
+const int Dir_Rank[Dir_Size] { -1, -1, +1, +1,  0,  0, -2, +2 };
+
+// variables
+
+static std::atomic<bool> G_Stop;
+static std::mutex G_Mutex; // for reports
+static int64 G_Report[Check_Size];
+
+// prototypes
+
+static void worker_loop (Worker & worker);
+static void walk        (Worker & worker, const Pos & start);
+
+static void check_pos (Worker & worker, const Pos & pos);
+static void report    (Worker & worker, Check check, const Pos & pos, const std::string & info);
+
+static Pos random_pos (Worker & worker);
+static Pos pos_flip   (const Pos & pos);
+
+static void ref_gen      (std::vector<Move> & moves, const Pos & pos);
+static void ref_captures (std::vector<Move> & moves, int & best, const Pos & pos, Square start, Square sq, bool king, Bit caps, bool can_end);
+static void ref_add      (std::vector<Move> & moves, int & best, const Pos & pos, Square start, Square sq, bool king, Bit caps);
+
+static bool square_next (Square sq, int dir, int steps, Square & to);
+
+// functions
+
+bool run(double time, int threads) {
+
+   static const char * Variants[] { "normal", "killer", "bt", "frisian", "losing" };
+
+   std::string variant = var::get("variant");
+   std::string bb_size = var::get("bb-size");
+
+   int64 count[Check_Size] {};
+   int64 fail[Check_Size] {};
+   int64 pos = 0;
+
+   Timer timer;
+   timer.start();
+
+   for (const char * name : Variants) {
+
+      // bitbases are only available for the configured variant
+
+      var::set("variant", name);
+      var::set("bb-size", (variant == name) ? bb_size : "0");
+      var::update();
+
+      bit::init();
+      eval_init();
+      if (var::BB) bb::init();
+
+      std::cout << "fuzzing " << name << " for " << time << "s with " << threads << " thread(s)" << std::endl;
+
+      G_Stop = false;
+
+      std::vector<Worker> worker(threads);
+      std::vector<std::thread> thread;
+
+      for (int id = 0; id < threads; id++) {
+         worker[id].rand.seed(ml::rand_int_64() + id);
+         thread.emplace_back(worker_loop, std::ref(worker[id]));
+      }
+
+      std::this_thread::sleep_for(std::chrono::duration<double>(time));
+      G_Stop = true;
+
+      for (auto & th : thread) {
+         th.join();
+      }
+
+      for (const Worker & w : worker) {
+
+         for (int i = 0; i < Check_Size; i++) {
+            count[i] += w.count[i];
+            fail[i]  += w.fail[i];
+         }
+
+         pos += w.pos;
+      }
+   }
+
+   var::set("variant", variant);
+   var::set("bb-size", bb_size);
+   var::update();
+
+   // summary
+
+   double elapsed = timer.elapsed();
+
+   int64 total = 0;
+   bool ok = true;
+
+   std::cout << std::endl;
+
+   for (int i = 0; i < Check_Size; i++) {
+      std::cout << Check_Name[i] << ": " << count[i] << " checks, " << fail[i] << " failures" << std::endl;
+      total += count[i];
+      if (fail[i] != 0) ok = false;
+   }
+
+   std::cout << pos << " positions, " << ml::ftos(double(total) / elapsed * 60.0 / 1E6, 1) << "M checks/min" << std::endl;
+   std::cout << std::endl;
+
+   return ok;
+}
+
+static void worker_loop(Worker & worker) {
+
+   for (int i = 0; !G_Stop; i++) {
+      walk(worker, (i % 2 == 0) ? pos::Start : random_pos(worker));
+   }
+}
+
+static void walk(Worker & worker, const Pos & start) {
+
+   Pos pos = start;
+
+   for (int ply = 0; ply < Ply_Max && !G_Stop; ply++) {
+
+      check_pos(worker, pos);
+
+      List list;
+      gen_moves(list, pos);
+
+      if (list.size() == 0 || pos::is_wipe(pos)) break; // BT ends on promotion
+
+      Move mv = list[int(worker.rand() % uint64(list.size()))];
+
+      Pos new_pos = pos.succ(mv);
+
+      // Pos::succ() vs FEN round trip
+
+      worker.count[Check_FEN]++;
+
+      Bit caps = move::captured(mv, pos);
+
+      if (pos::size(new_pos) != pos::size(pos) - bit::count(caps)
+       || new_pos.turn() != side_opp(pos.turn())
+       || !new_pos.is_side(move::to(mv, pos), pos.turn())
+       ) {
+         report(worker, Check_FEN, pos, "succ " + move::to_hub(mv, pos));
+      }
+
+      try {
+         if (move::from_hub(move::to_hub(mv, pos), pos) != mv) report(worker, Check_FEN, pos, "move " + move::to_hub(mv, pos));
+      } catch (const Bad_Input &) {
+         report(worker, Check_FEN, pos, "move " + move::to_hub(mv, pos));
+      }
+
+      pos = new_pos;
+   }
+}
+
+static void check_pos(Worker & worker, const Pos & pos) {
+
+   worker.pos++;
+
+   // hash::key() vs full recompute, Pos::flip() vs square-by-square flip
+
+   worker.count[Check_Key]++;
+
+   if (hash::key(pos) != hash::key_ref(pos)) {
+      report(worker, Check_Key, pos, "");
+   } else if (!(pos.flip().flip() == pos)) {
+      report(worker, Check_Key, pos, "flip twice");
+   } else if (hash::canonical(pos) != hash::canonical(pos.flip())) {
+      report(worker, Check_Key, pos, "canonical");
+   } else if (pos.count(White) == 0 && pos.count(Black) == 0 && !(pos.flip() == pos_flip(pos))) {
+      report(worker, Check_Key, pos, "flip");
+   }
+
+   // gen_moves() vs naive generator
+
+   worker.count[Check_Gen]++;
+
+   List list;
+   gen_moves(list, pos);
+
+   std::vector<Move> fast(list.begin(), list.end());
+   std::sort(fast.begin(), fast.end());
+
+   std::vector<Move> ref;
+   ref_gen(ref, pos);
+
+   bool has_capture = !ref.empty() && move::is_capture(ref[0], pos);
+
+   if (std::adjacent_find(fast.begin(), fast.end()) != fast.end()) {
+      report(worker, Check_Gen, pos, "duplicate move");
+   } else if (fast != ref) {
+      report(worker, Check_Gen, pos, std::to_string(fast.size()) + " moves vs " + std::to_string(ref.size()));
+   } else if (can_capture(pos, pos.turn()) != has_capture) {
+      report(worker, Check_Gen, pos, "can_capture");
+   } else if (can_move(pos, pos.turn()) != !ref.empty()) {
+      report(worker, Check_Gen, pos, "can_move");
+   } else if (count_moves(pos) != int(ref.size())) {
+      report(worker, Check_Gen, pos, "count_moves");
+   } else if (count_captures(pos) != (has_capture ? int(ref.size()) : 0)) {
+      report(worker, Check_Gen, pos, "count_captures");
+   }
+
+   // eval() vs colour-flipped eval()
+
+   if (pos.count(White) == 0 && pos.count(Black) == 0) { // wolves are lost by the flip
+
+      worker.count[Check_Eval]++;
+
+      Score sc = eval(pos);
+      Score flip = eval(pos_flip(pos));
+
+      if (std::abs(sc - flip) > 1) { // rounding is not symmetric
+         report(worker, Check_Eval, pos, std::to_string(sc) + " vs " + std::to_string(flip));
+      }
+   }
+
+   // on-line bitbase decompression vs full RLE scan
+
+   if (var::BB && bb::pos_is_load(pos) && !pos::is_capture(pos) && !pos::is_wipe(pos)) {
+
+      worker.count[Check_BB]++;
+
+      int fast = bb::probe_raw(pos);
+      int slow = bb::probe_raw_ref(pos);
+
+      if (fast != slow) report(worker, Check_BB, pos, bb::value_to_string(fast) + " vs " + bb::value_to_string(slow));
+   }
+
+   // FEN and hub round trips (wolf counts are not part of FEN)
+
+   worker.count[Check_FEN]++;
+
+   Pos base(pos.turn(), pos.wm(), pos.bm(), pos.wk(), pos.bk());
+
+   try {
+      if (!(pos_from_fen(pos_fen(pos)) == base)) report(worker, Check_FEN, pos, "FEN");
+      if (!(pos_from_hub(pos_hub(pos)) == base)) report(worker, Check_FEN, pos, "hub");
+   } catch (const Bad_Input &) {
+      report(worker, Check_FEN, pos, "parse");
+   }
+}
+
+static void report(Worker & worker, Check check, const Pos & pos, const std::string & info) {
+
+   worker.fail[check]++;
+
+   std::lock_guard<std::mutex> lock(G_Mutex);
+
+   if (G_Report[check]++ < Fail_Max) {
+      std::cout << "fuzz: " << Check_Name[check] << " diverges: " << pos_fen(pos);
+      if (!info.empty()) std::cout << " (" << info << ")";
+      std::cout << std::endl;
+   }
+}
+
+static Pos random_pos(Worker & worker) {
+
+   // random material, men are never on their promotion rank
+
+   while (true) {
+
+      Bit wm {}, bm {}, wk {}, bk {};
+      Bit all {};
+
+      int size = 2 + int(worker.rand() % 20);
+
+      for (int i = 0; i < size; i++) {
+
+         Square sq = square_sparse(int(worker.rand() % Dense_Size));
+         if (bit::has(all, sq)) continue;
+
+         int pc = int(worker.rand() % 8); // men are more frequent
+         if (var::Variant == var::BT) pc &= ~1; // no kings
+
+         if (false) {
+         } else if (pc == 1) {
+            bit::set(wk, sq);
+         } else if (pc == 3) {
+            bit::set(bk, sq);
+         } else if (pc % 4 == 0) {
+            if (!bit::has(bit::WM_Squares, sq)) continue;
+            bit::set(wm, sq);
+         } else {
+            if (!bit::has(bit::BM_Squares, sq)) continue;
+            bit::set(bm, sq);
+         }
+
+         bit::set(all, sq);
+      }
+
+      if ((wm | wk) == 0 || (bm | bk) == 0) continue;
+
+      Side turn = side_make(int(worker.rand() % 2));
+      return Pos(turn, wm, bm, wk, bk);
+   }
+}
+
+static Pos pos_flip(const Pos & pos) {
+
+   Bit b[Piece_Side_Size] {};
+
+   for (Square sq : pos.all()) {
+      Piece_Side ps = pos::piece_side(pos, sq);
+      bit::set(b[ps ^ 1], square_opp(sq)); // swap colours
+   }
+
+   return Pos(side_opp(pos.turn()), b[White_Man], b[Black_Man], b[White_King], b[Black_King]);
+}
+
+// reference move generator: one square at a time, no precomputed tables
+
+static void ref_gen(std::vector<Move> & moves, const Pos & pos) {
+
+   moves.clear();
+
+   Side atk = pos.turn();
+
+   // captures
+
+   int best = 0;
+
+   for (Square from : pos.side(atk)) {
+      ref_captures(moves, best, pos, from, from, pos.is_piece(from, King), Bit(0), false);
+   }
+
+   // quiet moves
+
+   if (moves.empty()) {
+
+      for (Square from : pos.man(atk)) {
+
+         for (int dir = 0; dir < 4; dir++) {
+
+            Square to;
+            bool forward = (atk == White) ? Dir_Rank[dir] < 0 : Dir_Rank[dir] > 0;
+
+            if (forward && square_next(from, dir, 1, to) && pos.is_empty(to)) {
+               moves.push_back(move::make(from, to));
+            }
+         }
+      }
+
+      for (Square from : pos.king(atk)) {
+
+         if (var::Variant == var::Frisian && pos.count(atk) >= 3 && from == pos.wolf(atk)) continue;
+
+         for (int dir = 0; dir < 4; dir++) {
+
+            Square to;
+
+            for (int i = 1; square_next(from, dir, i, to) && pos.is_empty(to); i++) {
+               moves.push_back(move::make(from, to));
+            }
+         }
+      }
+   }
+
+   std::sort(moves.begin(), moves.end());
+   moves.erase(std::unique(moves.begin(), moves.end()), moves.end());
+}
+
+static void ref_captures(std::vector<Move> & moves, int & best, const Pos & pos, Square start, Square sq, bool king, Bit caps, bool can_end) {
+
+   Side def = side_opp(pos.turn());
+
+   int dir_size = (var::Variant == var::Frisian) ? 8 : 4;
+
+   // captured pieces stay on the board until the end of the move
+
+   auto is_empty = [&](Square s) { return pos.is_empty(s) || s == start; };
+
+   for (int dir = 0; dir < dir_size; dir++) {
+
+      Square jump;
+      int i = 1;
+
+      if (king) {
+         while (square_next(sq, dir, i, jump) && is_empty(jump)) i++;
+      }
+
+      if (!square_next(sq, dir, i, jump)) continue;
+      if (!pos.is_side(jump, def) || bit::has(caps, jump)) continue;
+
+      Bit new_caps = caps;
+      bit::set(new_caps, jump);
+
+      for (int j = i + 1; true; j++) {
+
+         Square to;
+         if (!square_next(sq, dir, j, to) || !is_empty(to)) break;
+
+         // Killer: a king that captured a king stops right behind it
+
+         bool end = !(var::Variant == var::Killer && king && pos.is_piece(jump, King) && j != i + 1);
+         ref_captures(moves, best, pos, start, to, king, new_caps, end);
+
+         if (!king) break; // men land right behind
+      }
+   }
+
+   if (caps != 0 && can_end) ref_add(moves, best, pos, start, sq, king, caps);
+}
+
+static void ref_add(std::vector<Move> & moves, int & best, const Pos & pos, Square start, Square sq, bool king, Bit caps) {
+
+   int score = (var::Variant == var::Frisian)
+             ? bit::count(caps & pos.man()) * 64 + bit::count(caps & pos.king()) * 126 + int(king)
+             : bit::count(caps);
+
+   if (score > best) {
+      best = score;
+      moves.clear();
+   }
+
+   if (score == best) moves.push_back(move::make(start, sq, caps));
+}
+
+static bool square_next(Square sq, int dir, int steps, Square & to) {
+
+   int fl = square_file(sq) + Dir_File[dir] * steps;
+   int rk = square_rank(sq) + Dir_Rank[dir] * steps;
+
+   if (!square_is_ok(fl, rk)) return false;
+
+   to = square_make(fl, rk);
+   return true;
+}
+
+} // namespace fuzz
+
@@ -0,0 +1,19 @@
+
+#ifndef FUZZ_HPP
+#define FUZZ_HPP
+
+// includes
+
+#include "common.hpp"
+#include "libmy.hpp"
+
+namespace fuzz {
+
+// functions
+
+bool run (double time, int threads); // seconds per variant, true if no divergence
+
+} // namespace fuzz
+
+#endif // !defined FUZZ_HPP
+
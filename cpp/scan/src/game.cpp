@@ -80,7 +80,7 @@ void Game::go_to(int ply) {
 }
 
 bool Game::is_end(bool use_bb) const {
-   return node().is_end() || (use_bb && bb::pos_is_load(pos()));
+   return node().is_end() || (use_bb && bb::pos_is_known(pos()));
 }
 
 int Game::result(bool use_bb, Side sd) const {
@@ -93,7 +93,7 @@ int Game::result(bool use_bb, Side sd) const {
       res = pos::result(pos(), White);
    } else if (node().is_draw(3)) {
       res = 0;
-   } else if (use_bb && bb::pos_is_load(pos())) {
+   } else if (use_bb && bb::pos_is_known(pos())) {
       res = bb::value_nega(bb::probe(pos()), turn()); // for white
    } else {
       assert(false);
@@ -360,6 +360,49 @@ bool can_capture(const Pos & pos, Side sd) {
    return false;
 }
 
+int count_moves(const Pos & pos) {
+
+   int n = count_captures(pos);
+   if (n != 0) return n;
+
+   Side atk = pos.turn();
+
+   Bit be = pos.empty();
+
+   // men
+
+   Bit bm = pos.man(atk);
+
+   if (atk == White) {
+      n += bit::count(bm & (be << I1)) + bit::count(bm & (be << J1));
+   } else {
+      n += bit::count(bm & (be >> I1)) + bit::count(bm & (be >> J1));
+   }
+
+   // kings
+
+   for (Square from : pos.king(atk)) {
+
+      if (var::Variant == var::Frisian && pos.count(atk) >= 3 && from == pos.wolf(atk)) continue;
+
+      n += bit::count(bit::king_moves(from, be) & be);
+   }
+
+   return n;
+}
+
+int count_captures(const Pos & pos) {
+
+   if (!can_capture(pos, pos.turn())) return 0; // common case, bitboards only
+
+   // majority rule and duplicate removal need the actual sequences
+
+   List list;
+   gen_captures(list, pos);
+
+   return list.size();
+}
+
 static Bit contact_captures(const Pos & pos, Side sd) {
 
    Bit ba = pos.side(sd);
@@ -20,5 +20,8 @@ void add_sacs       (List & list, const Pos & pos);
 bool can_move    (const Pos & pos, Side sd);
 bool can_capture (const Pos & pos, Side sd);
 
+int count_moves    (const Pos & pos); // == gen_moves().size()
+int count_captures (const Pos & pos); // == gen_captures().size()
+
 #endif // !defined GEN_HPP
 
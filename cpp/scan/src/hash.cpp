@@ -1,6 +1,8 @@
 
 // includes
 
+#include <algorithm>
+
 #include "bit.hpp"
 #include "common.hpp"
 #include "hash.hpp"
@@ -87,10 +89,14 @@ static Key table_key(Piece pc, Side sd, int index, int offset) {
 }
 
 Key key(const Pos & pos) {
+   Key key = key_men(pos);
+   key ^= key_kings(pos);
+   return key;
+}
 
-   Key key {};
+Key key_men(const Pos & pos) {
 
-   // men
+   Key key {};
 
    key ^= Key_Ranks_123[(pos.wm() >>  6) & Table_Mask];
    key ^= Key_Ranks_456[(pos.wm() >> 26) & Table_Mask];
@@ -100,6 +106,13 @@ Key key(const Pos & pos) {
    key ^= Key_Ranks_345[(pos.bm() >> 19) & Table_Mask];
    key ^= Key_Ranks_678[(pos.bm() >> 39) & Table_Mask];
 
+   return key;
+}
+
+Key key_kings(const Pos & pos) {
+
+   Key key {};
+
    // kings
 
    for (int sd = 0; sd < Side_Size; sd++) {
@@ -125,5 +138,34 @@ Key key(const Pos & pos) {
    return key;
 }
 
+Key canonical(const Pos & pos) { // scores from the side to move and game results are flip invariant
+   return std::min(key(pos), key(pos.flip()));
+}
+
+Key key_ref(const Pos & pos) {
+
+   Key key {};
+
+   for (int sd = 0; sd < Side_Size; sd++) {
+      for (int pc = 0; pc < Piece_Size; pc++) {
+         for (Square sq : pos.piece_side(Piece(pc), Side(sd))) {
+            key ^= Key_Piece[sd][pc][sq];
+         }
+      }
+   }
+
+   if (var::Variant == var::Frisian) {
+
+      for (int side = 0; side < Side_Size; side++) {
+         Side sd = side_make(side);
+         if (pos.count(sd) != 0) key ^= Key_Wolf[sd][pos.count(sd)][pos.wolf(sd)];
+      }
+   }
+
+   if (pos.turn() != White) key ^= Key_Turn;
+
+   return key;
+}
+
 } // namespace hash
 
@@ -15,7 +15,11 @@ namespace hash {
 
 void init ();
 
-Key key (const Pos & pos);
+Key key       (const Pos & pos); // key_men() ^ key_kings()
+Key key_men   (const Pos & pos); // men only, for the eval cache
+Key key_kings (const Pos & pos); // kings, wolves and side to move
+Key key_ref   (const Pos & pos); // square by square, for testing
+Key canonical (const Pos & pos); // same for a position and its colour flip
 
 inline int    index (Key key, int mask) { return uint64(key) & mask; }
 inline uint32 lock  (Key key)           { return uint64(key) >> 32; }
@@ -7,6 +7,7 @@
 
 #include "hub.hpp"
 #include "libmy.hpp"
+#include "logger.hpp"
 #include "thread.hpp" // for get_line
 #include "util.hpp"
 
@@ -14,13 +15,15 @@ namespace hub {
 
 // prototypes
 
-static std::string hub_pair  (const std::string & name, const std::string & value);
-static std::string hub_value (const std::string & value);
+static void add_name  (std::string & line, const std::string & name);
+static void add_value (std::string & line, const std::string & value);
 
 // functions
 
 void error(const std::string & msg) {
-   write(std::string("error ") + hub_pair("message", msg));
+   std::string line = "error";
+   add_pair(line, "message", msg);
+   write(line);
 }
 
 std::string read() {
@@ -32,35 +35,62 @@ std::string read() {
 }
 
 void write(const std::string & line) {
-   std::cout << line << std::endl;
+   logger::put(logger::Level::Reply, line);
 }
 
 void add_pair(std::string & line, const std::string & name, int value) {
-   line += " " + hub_pair(name, std::to_string(value));
+   add_pair(line, name, int64(value));
+}
+
+void add_pair(std::string & line, const std::string & name, int64 value) {
+
+   add_name(line, name);
+
+   char buf[24];
+   int size = 0;
+
+   uint64 n = (value < 0) ? -uint64(value) : uint64(value);
+
+   do {
+      buf[size++] = char('0' + n % 10);
+      n /= 10;
+   } while (n != 0);
+
+   if (value < 0) line += '-';
+
+   while (size != 0) {
+      line += buf[--size];
+   }
 }
 
 void add_pair(std::string & line, const std::string & name, double value, int /* precision */) { // TODO: use precision
-   line += " " + hub_pair(name, std::to_string(value));
+   add_name(line, name);
+   line += std::to_string(value);
 }
 
 void add_pair(std::string & line, const std::string & name, const std::string & value) {
-   line += " " + hub_pair(name, value);
+   add_name(line, name);
+   add_value(line, value);
 }
 
-static std::string hub_pair(const std::string & name, const std::string & value) {
-   return name + "=" + hub_value(value);
+static void add_name(std::string & line, const std::string & name) {
+   line += ' ';
+   line += name;
+   line += '=';
 }
 
-static std::string hub_value(const std::string & value) {
+static void add_value(std::string & line, const std::string & value) {
 
    if (Scanner::is_name(value)) {
-      return value;
+      line += value;
    } else {
-      return std::string("\"") + value + "\""; // TODO: protect '"'?
+      line += '"';
+      line += value; // TODO: protect '"'?
+      line += '"';
    }
 }
 
-Scanner::Scanner(const std::string & s) : m_string{s} {}
+Scanner::Scanner(const std::string & s) : m_string{s.data()}, m_size{int(s.size())} {}
 
 std::string Scanner::get_command() {
    return get_name();
@@ -68,58 +98,63 @@ std::string Scanner::get_command() {
 
 Pair Scanner::get_pair() {
 
-   std::string name = get_name(); // <name>
+   Pair pair;
 
-   std::string value;
+   pair.name = get_name(); // <name>
 
    skip_blank();
 
    if (peek_char() == '=') { // = <value>
       skip_char();
-      value = get_value();
+      pair.value = get_value();
    }
 
-   return {name, value};
+   return pair;
 }
 
 std::string Scanner::get_name() {
-
-   std::string name;
-
    skip_blank();
-
-   while (is_id(peek_char())) {
-      name += get_char();
-   }
-
-   if (name.empty()) throw Bad_Input(); // not a name
-
-   return name;
+   return get_word();
 }
 
 std::string Scanner::get_value() {
 
-   std::string value;
-
    skip_blank();
 
    if (peek_char() == '"') { // "<value>"
 
       skip_char();
 
+      int begin = m_pos;
+
       while (peek_char() != '"') {
          if (is_end()) throw Bad_Input(); // missing closing '"'
-         value += get_char();
+         skip_char();
       }
 
+      std::string value(m_string + begin, m_pos - begin);
+
       skip_char(); // closing '"'
 
+      return value;
+
    } else { // <value>
 
-      value = get_name();
+      return get_word();
+   }
+}
+
+std::string Scanner::get_word() {
+
+   int begin = m_pos;
+
+   while (is_id(peek_char())) {
+      skip_char();
    }
 
-   return value;
+   if (m_pos == begin) throw Bad_Input(); // not a name
+
+   return std::string(m_string + begin, m_pos - begin);
 }
 
 bool Scanner::eos() {
@@ -138,17 +173,12 @@ void Scanner::skip_char() {
    m_pos++;
 }
 
-char Scanner::get_char() {
-   assert(!is_end());
-   return m_string[m_pos++];
-}
-
 char Scanner::peek_char() const {
    return is_end() ? '\0' : m_string[m_pos]; // HACK but makes parsing easier
 }
 
 bool Scanner::is_end() const {
-   return m_pos == int(m_string.size());
+   return m_pos == m_size;
 }
 
 bool Scanner::is_name(const std::string & s) {
@@ -22,12 +22,14 @@ class Scanner {
 
 private:
 
-   const std::string m_string;
+   const char * m_string; // not owned, the line must outlive the scanner
+   int m_size;
    int m_pos {0};
 
 public:
 
    explicit Scanner (const std::string & s);
+   explicit Scanner (std::string && s) = delete; // would dangle
 
    std::string get_command ();
    Pair        get_pair    ();
@@ -42,7 +44,8 @@ private:
 
    void skip_blank ();
    void skip_char  ();
-   char get_char   ();
+
+   std::string get_word (); // extracted in one go
 
    bool is_end    () const;
    char peek_char () const;
@@ -58,7 +61,10 @@ void error (const std::string & msg);
 std::string read  ();
 void        write (const std::string & line);
 
+// append " <name>=<value>" in place, no temporaries
+
 void add_pair (std::string & line, const std::string & name, int value);
+void add_pair (std::string & line, const std::string & name, int64 value);
 void add_pair (std::string & line, const std::string & name, double value, int precision);
 void add_pair (std::string & line, const std::string & name, const std::string & value);
 
@@ -93,6 +93,25 @@ uint64 get_bytes(std::istream & stream, int size) {
    return bytes;
 }
 
+void put_byte(std::ostream & stream, int byte) {
+
+   assert(byte >= 0 && byte < 256);
+
+   if (!stream.put(char(byte))) {
+      std::cerr << "error while writing file" << std::endl;
+      std::exit(EXIT_FAILURE);
+   }
+}
+
+void put_bytes(std::ostream & stream, uint64 bytes, int size) {
+
+   assert(size >= 0 && size <= 8);
+
+   for (int i = size - 1; i >= 0; i--) {
+      put_byte(stream, int((bytes >> (i * 8)) & 0xFF));
+   }
+}
+
 // string
 
 std::string ftos(double x, int decimals) {
@@ -87,13 +87,23 @@ inline uint64 bit      (int n) { return uint64(1) << n; }
 inline uint64 bit_mask (int n) { return bit(n) - 1; }
 
 #ifdef _MSC_VER
-inline int bit_first (uint64 b) { assert(b != 0); unsigned long i; _BitScanForward64(&i, b); return i; }
-inline int bit_count (uint64 b) { return int(__popcnt64(b)); }
+inline int    bit_first (uint64 b) { assert(b != 0); unsigned long i; _BitScanForward64(&i, b); return i; }
+inline int    bit_count (uint64 b) { return int(__popcnt64(b)); }
+inline uint64 byte_swap (uint64 b) { return _byteswap_uint64(b); }
 #else
-inline int bit_first (uint64 b) { assert(b != 0); return __builtin_ctzll(b); }
-inline int bit_count (uint64 b) { return __builtin_popcountll(b); }
+inline int    bit_first (uint64 b) { assert(b != 0); return __builtin_ctzll(b); }
+inline int    bit_count (uint64 b) { return __builtin_popcountll(b); }
+inline uint64 byte_swap (uint64 b) { return __builtin_bswap64(b); }
 #endif
 
+inline uint64 bit_reverse(uint64 b) {
+   b = byte_swap(b);
+   b = ((b >> 4) & 0x0F0F0F0F0F0F0F0F) | ((b & 0x0F0F0F0F0F0F0F0F) << 4);
+   b = ((b >> 2) & 0x3333333333333333) | ((b & 0x3333333333333333) << 2);
+   b = ((b >> 1) & 0x5555555555555555) | ((b & 0x5555555555555555) << 1);
+   return b;
+}
+
 // stream
 
 int64 stream_size (std::istream & stream);
@@ -101,6 +111,9 @@ int64 stream_size (std::istream & stream);
 int    get_byte  (std::istream & stream);
 uint64 get_bytes (std::istream & stream, int size);
 
+void put_byte  (std::ostream & stream, int byte);
+void put_bytes (std::ostream & stream, uint64 bytes, int size);
+
 // string
 
 std::string ftos (double x, int decimals);
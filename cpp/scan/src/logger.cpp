@@ -0,0 +1,200 @@
+
+// includes
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+#include "libmy.hpp"
+#include "logger.hpp"
+#include "thread.hpp"
+
+namespace logger {
+
+// constants
+
+const int Size {1 << 10}; // lines in flight
+
+// types
+
+struct Cell {
+   std::atomic<uint64> seq;
+   Level level;
+   std::string line;
+};
+
+// variables
+
+// HACK: never freed, the detached writer outlives static destructors
+
+static Cell * G_Cell {nullptr};
+static Waitable * G_Wake {nullptr};
+
+static std::atomic<uint64> G_Head {0}; // producers
+static uint64 G_Tail {0}; // writer only
+static std::atomic<uint64> G_Done {0}; // lines written and flushed
+
+static std::atomic<int64> G_Dropped {0};
+
+static std::atomic<bool> G_Active {false};
+static std::atomic<bool> G_Sleeping {false};
+
+static Lockable G_Sync; // before init()
+
+// prototypes
+
+static void writer ();
+
+static bool push  (Level level, const std::string & line);
+static bool pop   (Level & level, std::string & line);
+static bool ready ();
+
+static void write (Level level, const std::string & line);
+
+// functions
+
+void init() {
+
+   if (G_Active) return;
+
+   G_Cell = new Cell[Size];
+   G_Wake = new Waitable;
+
+   for (int i = 0; i < Size; i++) {
+      G_Cell[i].seq = uint64(i);
+   }
+
+   G_Active = true;
+
+   std::thread(writer).detach();
+   std::atexit(flush); // also on std::exit()
+}
+
+void flush() {
+
+   if (!G_Active) return;
+
+   uint64 head = G_Head.load();
+
+   while (G_Done.load() < head) {
+      std::this_thread::yield();
+   }
+}
+
+void put(Level level, const std::string & line) {
+
+   if (!G_Active) {
+      G_Sync.lock();
+      write(level, line);
+      std::fflush(stdout);
+      G_Sync.unlock();
+      return;
+   }
+
+   while (!push(level, line)) { // full
+
+      if (level == Level::Info) {
+         G_Dropped += 1;
+         return;
+      }
+
+      std::this_thread::yield(); // replies and errors wait for the writer
+   }
+
+   std::atomic_thread_fence(std::memory_order_seq_cst); // pairs with the writer going to sleep
+
+   if (G_Sleeping.load()) {
+      G_Wake->lock();
+      G_Wake->signal();
+      G_Wake->unlock();
+   }
+}
+
+int64 dropped() {
+   return G_Dropped;
+}
+
+static void writer() {
+
+   Level level;
+   std::string line;
+
+   while (true) {
+
+      uint64 n = 0;
+
+      while (pop(level, line)) {
+         write(level, line);
+         n += 1;
+      }
+
+      if (n != 0) {
+         std::fflush(stdout);
+         std::fflush(stderr);
+         G_Done += n;
+         continue;
+      }
+
+      G_Wake->lock();
+
+      G_Sleeping = true;
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+
+      if (!ready()) G_Wake->wait(); // spurious wake-ups are harmless
+      G_Sleeping = false;
+
+      G_Wake->unlock();
+   }
+}
+
+static bool push(Level level, const std::string & line) { // bounded MPSC queue, one sequence number per cell
+
+   uint64 pos = G_Head.load(std::memory_order_relaxed);
+
+   while (true) {
+
+      Cell & cell = G_Cell[pos & (Size - 1)];
+      int64 diff = int64(cell.seq.load(std::memory_order_acquire)) - int64(pos);
+
+      if (diff < 0) { // full
+         return false;
+      } else if (diff > 0) { // another producer took it
+         pos = G_Head.load(std::memory_order_relaxed);
+      } else if (G_Head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+         cell.level = level;
+         cell.line = line;
+         cell.seq.store(pos + 1, std::memory_order_release);
+         return true;
+      }
+   }
+}
+
+static bool pop(Level & level, std::string & line) {
+
+   if (!ready()) return false;
+
+   Cell & cell = G_Cell[G_Tail & (Size - 1)];
+
+   level = cell.level;
+   line = std::move(cell.line);
+
+   cell.seq.store(G_Tail + Size, std::memory_order_release);
+   G_Tail += 1;
+
+   return true;
+}
+
+static bool ready() {
+   return G_Cell[G_Tail & (Size - 1)].seq.load(std::memory_order_acquire) == G_Tail + 1;
+}
+
+static void write(Level level, const std::string & line) {
+   std::FILE * file = (level == Level::Error) ? stderr : stdout;
+   std::fwrite(line.data(), 1, line.size(), file);
+   std::fputc('\n', file);
+}
+
+} // namespace logger
+
@@ -0,0 +1,33 @@
+
+#ifndef LOGGER_HPP
+#define LOGGER_HPP
+
+// includes
+
+#include <string>
+
+#include "libmy.hpp"
+
+namespace logger {
+
+// types
+
+enum class Level : int {
+   Info,  // progress (search lines, init messages), dropped when the queue is full
+   Reply, // protocol answers, never dropped
+   Error, // to stderr, never dropped
+};
+
+// functions
+
+void init  (); // starts the writer thread; output is synchronous before
+void flush (); // waits until all queued lines are written
+
+void put (Level level, const std::string & line); // never blocks on I/O
+
+int64 dropped ();
+
+} // namespace logger
+
+#endif // !defined LOGGER_HPP
+
@@ -1,8 +1,10 @@
 
 // includes
 
+#include <algorithm>
 #include <cmath>
 #include <cstdlib>
+#include <exception>
 #include <fstream>
 #include <iostream>
 #include <sstream>
@@ -12,24 +14,32 @@
 #include "bb_base.hpp"
 #include "bb_comp.hpp"
 #include "bb_index.hpp"
+#include "bench.hpp"
 #include "bit.hpp"
 #include "book.hpp"
+#include "cluster.hpp"
 #include "common.hpp"
 #include "dxp.hpp"
 #include "eval.hpp"
 #include "fen.hpp"
+#include "fuzz.hpp"
 #include "game.hpp"
 #include "gen.hpp"
 #include "hash.hpp"
 #include "hub.hpp"
 #include "libmy.hpp"
 #include "list.hpp"
+#include "logger.hpp"
 #include "move.hpp"
 #include "pos.hpp"
+#include "puzzle.hpp"
 #include "search.hpp"
 #include "sort.hpp"
+#include "startup.hpp"
 #include "thread.hpp"
+#include "timeman.hpp"
 #include "tt.hpp"
+#include "tune.hpp"
 #include "util.hpp"
 #include "var.hpp"
 
@@ -66,6 +76,12 @@ static void hub_loop ();
 
 static void disp_game (const Game & game);
 
+static void eval_profile (int games, Depth depth);
+static void sort_learn   (int games, Depth depth, int epochs);
+static void sort_bench   (int games, Depth depth);
+
+static std::vector<Pos> self_play (int games, Depth depth);
+
 static void init_high ();
 static void init_low  ();
 
@@ -80,10 +96,13 @@ int main(int argc, char * argv[]) {
    std::string arg {};
    if (argc > 1) arg = argv[1];
 
+   logger::init();
+
    bit::init();
    hash::init();
    pos::init();
    var::init();
+   tune::init();
 
    bb::index_init();
    bb::comp_init();
@@ -105,6 +124,219 @@ int main(int argc, char * argv[]) {
 
       dxp::loop();
 
+   } else if (arg == "worker") {
+
+      var::set("cluster-workers", "0"); // workers don't have workers
+      var::update();
+
+      init_high();
+
+      cluster::loop();
+
+   } else if (arg == "eval-profile") { // [<games> [<depth>]]
+
+      int games = (argc > 2) ? std::stoi(argv[2]) : 100;
+      int depth = (argc > 3) ? std::stoi(argv[3]) : 8;
+
+      var::set("threads", "1"); // the profile is not thread safe
+      var::set("cluster-workers", "0");
+      var::update();
+
+      init_high();
+
+      eval_profile(games, Depth(depth));
+
+   } else if (arg == "sort-train") { // [<games> [<depth> [<epochs>]]]
+
+      int games = (argc > 2) ? std::stoi(argv[2]) : 100;
+      int depth = (argc > 3) ? std::stoi(argv[3]) : 8;
+      int epochs = (argc > 4) ? std::stoi(argv[4]) : 10;
+
+      var::set("threads", "1"); // sampling is not thread safe
+      var::set("cluster-workers", "0");
+      var::update();
+
+      init_high();
+
+      sort_learn(games, Depth(depth), epochs);
+
+   } else if (arg == "sort-bench") { // [<games> [<depth>]]
+
+      int games = (argc > 2) ? std::stoi(argv[2]) : 10;
+      int depth = (argc > 3) ? std::stoi(argv[3]) : 12;
+
+      var::set("threads", "1"); // for reproducible node counts
+      var::set("cluster-workers", "0");
+      var::update();
+
+      init_high();
+
+      sort_bench(games, Depth(depth));
+
+   } else if (arg == "smpbench") { // [<threads> [<depth> [<JSON file>]]]
+
+      int threads = (argc > 2) ? std::stoi(argv[2]) : int(std::thread::hardware_concurrency());
+      int depth = (argc > 3) ? std::stoi(argv[3]) : 14;
+      std::string file_name = (argc > 4) ? argv[4] : "smpbench.json";
+
+      var::set("cluster-workers", "0");
+      var::update();
+
+      init_high();
+
+      bench::smp(std::max(1, std::min(threads, 16)), Depth(depth), file_name);
+
+   } else if (arg == "time-sim") { // <trace file> [<name>=<value> ...], see timeman::Policy
+
+      if (argc < 3) {
+         std::cerr << "usage: " << argv[0] << " time-sim <trace file> [<name>=<value> ...]" << std::endl;
+         std::exit(EXIT_FAILURE);
+      }
+
+      timeman::Policy policy;
+
+      for (int i = 3; i < argc; i++) {
+
+         std::string s = argv[i];
+         auto eq = s.find('=');
+
+         if (eq == std::string::npos || !policy.set(s.substr(0, eq), std::stod(s.substr(eq + 1)))) {
+            std::cerr << "unknown policy parameter \"" << s << "\"" << std::endl;
+            std::exit(EXIT_FAILURE);
+         }
+      }
+
+      timeman::simulate(argv[2], policy);
+
+   } else if (arg == "bb-shard") { // [<MB per shard>], slices up to "bb-size"
+
+      double size = (argc > 2) ? std::stod(argv[2]) : 64.0;
+
+      bb::shard(std::max(int64(size * double(1 << 20)), int64(1)));
+
+   } else if (arg == "bb-resolve") { // capture-resolved copies of the slices up to "bb-size"
+
+      init_high();
+
+      bb::resolve();
+
+   } else if (arg == "bb-sample") { // <material> <file> [<positions> [<threads>]], 0 positions => all
+
+      if (argc < 4) {
+         std::cerr << "usage: " << argv[0] << " bb-sample <material, e.g. 2011> <file> [<positions> [<threads>]]" << std::endl;
+         std::exit(EXIT_FAILURE);
+      }
+
+      std::string material = argv[2]; // as in slice names: men then kings, side to move first
+      std::string file_name = argv[3];
+      int64 size = (argc > 4) ? std::stoll(argv[4]) : 1000000;
+      int threads = (argc > 5) ? std::stoi(argv[5]) : int(std::thread::hardware_concurrency());
+
+      if (material.size() != 4 || material.find_first_not_of("012345678") != std::string::npos) {
+         std::cerr << "invalid material \"" << material << "\"" << std::endl;
+         std::exit(EXIT_FAILURE);
+      }
+
+      int n[4];
+      for (int i = 0; i < 4; i++) n[i] = material[i] - '0';
+
+      init_high();
+
+      if (!var::BB || n[0] + n[1] + n[2] + n[3] > var::BB_Size) {
+         std::cerr << "material \"" << material << "\" is not in the loaded bitbases" << std::endl;
+         std::exit(EXIT_FAILURE);
+      }
+
+      bb::ID id = bb::id_make(n[0], n[1], n[2], n[3]);
+
+      if (bb::id_is_illegal(id) || bb::id_is_end(id)) {
+         std::cerr << "material \"" << material << "\" has no bitbase" << std::endl;
+         std::exit(EXIT_FAILURE);
+      }
+
+      bb::sample(id, std::max(size, int64(0)), std::max(threads, 1), file_name);
+
+   } else if (arg == "bb-pack") { // <usage file> <MB> <output dir>, slices up to "bb-size", see "bb-usage"
+
+      if (argc < 5) {
+         std::cerr << "usage: " << argv[0] << " bb-pack <usage file> <MB> <output dir>" << std::endl;
+         std::exit(EXIT_FAILURE);
+      }
+
+      double size = std::stod(argv[3]);
+
+      bb::pack(argv[2], std::max(int64(size * double(1 << 20)), int64(0)), argv[4]);
+
+   } else if (arg == "bb-bench") { // [<positions>]
+
+      int size = (argc > 2) ? std::stoi(argv[2]) : 1000000;
+
+      init_high();
+
+      bench::bb(size);
+
+   } else if (arg == "movegen-bench") { // [<depth>]
+
+      int depth = (argc > 2) ? std::stoi(argv[2]) : 6;
+
+      init_high();
+
+      bench::movegen(Depth(std::max(depth, 1)));
+
+   } else if (arg == "eval-bench") { // [<depth>]
+
+      int depth = (argc > 2) ? std::stoi(argv[2]) : 10;
+
+      init_high();
+
+      bench::eval(Depth(std::max(depth, 1)));
+
+   } else if (arg == "hub-bench") { // [<rounds>]
+
+      int rounds = (argc > 2) ? std::stoi(argv[2]) : 10000;
+
+      init_high();
+
+      bench::hub_io(std::max(rounds, 1));
+
+   } else if (arg == "mine-puzzles") { // <games file> <output file> [<threads> [<depth>]]
+
+      if (argc < 4) {
+         std::cerr << "usage: " << argv[0] << " mine-puzzles <games file> <output file> [<threads> [<depth>]]" << std::endl;
+         std::exit(EXIT_FAILURE);
+      }
+
+      int threads = (argc > 4) ? std::stoi(argv[4]) : int(std::thread::hardware_concurrency());
+      int depth = (argc > 5) ? std::stoi(argv[5]) : 15;
+
+      init_high();
+
+      puzzle::mine(argv[2], argv[3], std::max(threads, 1), Depth(std::max(depth, 2)));
+
+   } else if (arg == "fuzz") { // [<seconds per variant> [<threads>]]
+
+      double time = (argc > 2) ? std::stod(argv[2]) : 10.0;
+      int threads = (argc > 3) ? std::stoi(argv[3]) : int(std::thread::hardware_concurrency());
+
+      init_high();
+
+      if (!fuzz::run(time, std::max(threads, 1))) std::exit(EXIT_FAILURE);
+
+   } else if (arg == "spsa") { // <iterations> [<games> [<nodes>]], tuning builds only
+
+      int iterations = (argc > 2) ? std::stoi(argv[2]) : 100;
+      int games = (argc > 3) ? std::stoi(argv[3]) : 16;
+      int64 nodes = (argc > 4) ? std::stoll(argv[4]) : 20000;
+
+      var::set("threads", "1");
+      var::set("tt-size", "18"); // cleared before every move
+      var::set("cluster-workers", "0");
+      var::update();
+
+      init_high();
+
+      tune::spsa(iterations, games, nodes);
+
    } else if (arg == "hub") {
 
       listen_input();
@@ -202,10 +434,13 @@ static void hub_loop() {
          param_bool("book");
          param_int ("book-ply", 0, 20);
          param_int ("book-margin", 0, 100);
+         param_bool("book-canonical");
          param_bool("ponder");
          param_int ("threads", 1, 16);
          param_int ("tt-size", 16, 30);
-         param_int ("bb-size", 0, 7);
+         param_int ("bb-size", 0, 8);
+         param_int ("bb-flat", 0, 4096);
+         param_bool("bb-lazy");
 
          hub::write("wait");
 
@@ -216,54 +451,12 @@ static void hub_loop() {
 
       } else if (command == "level") {
 
-         int depth = -1;
-         int64 nodes = -1;
-         double move_time = -1.0;
-
-         bool smart = false;
-         int moves = 0;
-         double game_time = 30.0;
-         double inc = 0.0;
-
-         bool infinite = false; // ignored
-         bool ponder = false; // ignored
-
-         while (!scan.eos()) {
-
-            auto p = scan.get_pair();
-
-            if (false) {
-            } else if (p.name == "depth") {
-               depth = std::stoi(p.value);
-            } else if (p.name == "nodes") {
-               nodes = std::stoll(p.value);
-            } else if (p.name == "move-time") {
-               move_time = std::stod(p.value);
-            } else if (p.name == "moves") {
-               smart = true;
-               moves = std::stoi(p.value);
-            } else if (p.name == "time") {
-               smart = true;
-               game_time = std::stod(p.value);
-            } else if (p.name == "inc") {
-               smart = true;
-               inc = std::stod(p.value);
-            } else if (p.name == "infinite") {
-               infinite = true;
-            } else if (p.name == "ponder") {
-               ponder = true;
-            }
-         }
-
-         if (depth >= 0) si.depth = Depth(depth);
-         if (nodes >= 0) si.nodes = nodes;
-         if (move_time >= 0.0) si.time = move_time;
-
-         if (smart) si.set_time(moves, game_time, inc);
+         si.set_level(scan);
 
       } else if (command == "new-game") {
 
          G_TT.clear();
+         cluster::new_game();
 
       } else if (command == "ping") {
 
@@ -598,6 +791,7 @@ void Terminal::new_game(const Pos & pos) {
    m_computer[side_opp(m_game.turn())] = opp;
 
    G_TT.clear();
+   cluster::new_game();
 }
 
 void Terminal::go_to(int ply) {
@@ -632,6 +826,129 @@ static void disp_game(const Game & game) {
    std::cout << std::endl;
 }
 
+static void eval_profile(int games, Depth depth) {
+
+   eval_profile_start();
+   self_play(games, depth);
+
+   std::string file_name = std::string("eval") + var::variant_name();
+   eval_profile_save(file_name);
+
+   std::cout << "wrote \"" << file_name << "\" and \"" << file_name << ".perm\" (copy both to data/)" << std::endl;
+}
+
+static void sort_learn(int games, Depth depth, int epochs) {
+
+   sort_model(false); // sample the history-only search
+   sort_sample_start();
+   self_play(games, depth);
+
+   std::string file_name = std::string("sort") + var::variant_name();
+   sort_train(file_name, epochs);
+
+   std::cout << "wrote \"" << file_name << "\" (copy to data/)" << std::endl;
+}
+
+static void sort_bench(int games, Depth depth) {
+
+   std::vector<Pos> ps = self_play(games, Depth(4));
+
+   std::vector<Pos> bench;
+
+   for (int i = 0; i < int(ps.size()); i += 8) { // spread over the game phases
+      bench.push_back(ps[i]);
+   }
+
+   std::cout << bench.size() << " positions, depth " << depth << std::endl;
+
+   for (int model = 0; model < 2; model++) {
+
+      sort_model(model != 0);
+
+      int64 node = 0;
+      int64 cut = 0;
+      int64 cut_first = 0;
+
+      Timer timer;
+      timer.start();
+
+      for (const Pos & pos : bench) {
+
+         G_TT.clear();
+
+         Search_Input si;
+         si.move = false;
+         si.book = false;
+         si.depth = depth;
+         si.output = Output_None;
+
+         Search_Output so;
+         search(so, Node(pos), si);
+
+         node += so.node;
+         cut += so.cut;
+         cut_first += so.cut_first;
+      }
+
+      timer.stop();
+
+      double time = timer.elapsed();
+
+      std::cout << (model != 0 ? "model:   " : "history: ");
+      std::cout << "nodes " << node;
+      std::cout << ", first-move cutoffs " << ml::ftos(double(cut_first) / double(std::max(cut, int64(1))) * 100.0, 2) << "%";
+      std::cout << ", time " << ml::ftos(time, 2) << "s";
+      std::cout << ", nps " << ml::ftos(double(node) / std::max(time, 0.001) / 1E6, 2) << "M";
+      std::cout << std::endl;
+   }
+}
+
+static std::vector<Pos> self_play(int games, Depth depth) {
+
+   std::vector<Pos> ps;
+
+   for (int i = 0; i < games; i++) {
+
+      Game game;
+      G_TT.clear();
+
+      while (!game.is_end() && game.ply() < 200) {
+
+         Move mv;
+
+         if (game.ply() < 6) { // random opening for variety
+
+            List list;
+            gen_moves(list, game.pos());
+
+            mv = list[int(ml::rand_int_64() % uint64(list.size()))];
+
+         } else {
+
+            ps.push_back(game.pos());
+
+            Search_Input si;
+            si.move = false;
+            si.book = false;
+            si.depth = depth;
+            si.output = Output_None;
+
+            Search_Output so;
+            search(so, game.node(), si);
+
+            mv = so.move;
+            if (mv == move::None) mv = quick_move(game.node());
+         }
+
+         game.add_move(mv);
+      }
+
+      std::cout << "game " << (i + 1) << "/" << games << ": " << game.ply() << " plies" << std::endl;
+   }
+
+   return ps;
+}
+
 static void init_high() {
 
    std::cout << std::endl;
@@ -644,12 +961,17 @@ static void init_high() {
 
 static void init_low() {
 
-   bit::init(); // depends on the variant
-   if (var::Book) book::init();
-   if (var::BB) bb::init();
+   startup::Report report = startup::init(); // book, bitbases, eval, sort and TT concurrently
+
+   for (const startup::Phase & phase : report.phase) {
+      if (phase.error != nullptr) std::rethrow_exception(phase.error);
+   }
+
+   logger::put(logger::Level::Info, report.to_string());
+
+   cluster::init(); // after the TT
 
-   eval_init();
-   G_TT.set_size(var::TT_Size);
+   logger::flush(); // init messages before synchronous output
 }
 
 static void param_bool(const std::string & name) {
@@ -1,6 +1,7 @@
 
 // includes
 
+#include <cctype>
 #include <string>
 
 #include "bit.hpp"
@@ -20,6 +21,9 @@ static bool is_man (Move mv, const Pos & pos);
 
 static Bit amb (const List & list, Square from, Square to, const Pos & pos);
 
+static void   add_square   (std::string & s, Square sq);
+static Square parse_square (const std::string & s, int & i);
+
 // functions
 
 Move make(Square from, Square to, Bit captured) {
@@ -119,23 +123,34 @@ static Bit amb(const List & list, Square from, Square to, const Pos & pos) {
 }
 
 std::string to_hub(Move mv, const Pos & pos) {
+   std::string s;
+   add_hub(s, mv, pos);
+   return s;
+}
+
+void add_hub(std::string & s, Move mv, const Pos & pos) {
 
    Square from = move::from(mv, pos);
    Square to   = move::to(mv, pos);
    Bit    caps = captured(mv, pos);
 
-   std::string s;
-
-   s += square_to_string(from);
-   s += (caps != 0) ? "x" : "-";
-   s += square_to_string(to);
+   add_square(s, from);
+   s += (caps != 0) ? 'x' : '-';
+   add_square(s, to);
 
    for (Square sq : caps) {
-      s += "x";
-      s += square_to_string(sq);
+      s += 'x';
+      add_square(s, sq);
    }
+}
 
-   return s;
+static void add_square(std::string & s, Square sq) {
+
+   int std = square_to_std(sq);
+   assert(std >= 1 && std <= 99);
+
+   if (std >= 10) s += char('0' + std / 10);
+   s += char('0' + std % 10);
 }
 
 Move from_string(const std::string & s, const Pos & pos) {
@@ -186,33 +201,45 @@ Move from_string(const std::string & s, const Pos & pos) {
    return move;
 }
 
-Move from_hub(const std::string & s, const Pos & /* pos */) {
+Move from_hub(const std::string & s, const Pos & /* pos */) { // <from>{-|x}<to>{x<captured>}
 
-   Scanner_Number scan(s);
-   std::string token;
+   int i = 0;
 
-   token = scan.get_token();
-   Square from = square_from_string(token);
+   Square from = parse_square(s, i);
 
-   token = scan.get_token();
-   if (token != "-" && token != "x") throw Bad_Input();
+   if (i == int(s.size()) || (s[i] != '-' && s[i] != 'x')) throw Bad_Input();
+   i++;
 
-   token = scan.get_token();
-   Square to = square_from_string(token);
+   Square to = parse_square(s, i);
 
    Bit caps {};
 
-   while (!scan.eos()) {
+   while (i != int(s.size())) {
 
-      token = scan.get_token();
-      if (token != "x") throw Bad_Input();
+      if (s[i] != 'x') throw Bad_Input();
+      i++;
 
-      token = scan.get_token();
-      bit::set(caps, square_from_string(token));
+      bit::set(caps, parse_square(s, i));
    }
 
    return make(from, to, caps);
 }
 
+static Square parse_square(const std::string & s, int & i) { // in place, no token copies
+
+   int begin = i;
+   int std = 0;
+
+   while (i != int(s.size()) && std::isdigit(s[i])) {
+      std = std * 10 + (s[i] - '0');
+      if (std > Dense_Size) throw Bad_Input();
+      i++;
+   }
+
+   if (i == begin) throw Bad_Input();
+
+   return square_from_std(std);
+}
+
 } // namespace move
 
@@ -36,6 +36,7 @@ bool is_legal (Move mv, const Pos & pos);
 
 std::string to_string (Move mv, const Pos & pos);
 std::string to_hub    (Move mv, const Pos & pos);
+void        add_hub   (std::string & s, Move mv, const Pos & pos); // appends, no temporaries
 
 Move from_string (const std::string & s, const Pos & pos);
 Move from_hub    (const std::string & s, const Pos & pos);
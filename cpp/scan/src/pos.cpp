@@ -35,9 +35,11 @@ Pos::Pos(Bit man, Bit king, Bit white, Bit black, Bit all, Side turn) {
    assert(bit::is_incl(man & white, bit::WM_Squares));
    assert(bit::is_incl(man & black, bit::BM_Squares));
 
+#ifndef NDEBUG
    Bit side[Side_Size] { white, black }; // for debug
    assert(side[side_opp(turn)] != 0);
    if (var::Variant == var::BT) assert((side[turn] & king) == 0);
+#endif
 
    m_piece = { man, king };
    m_side = { white, black };
@@ -108,6 +110,29 @@ Pos Pos::succ(Move mv) const {
    return pos;
 }
 
+Pos Pos::flip() const {
+
+   Pos pos(bit::opp(m_piece[Man]), bit::opp(m_piece[King]), bit::opp(m_side[Black]), bit::opp(m_side[White]), bit::opp(m_all), side_opp(m_turn));
+
+   for (int side = 0; side < Side_Size; side++) {
+      Side sd = side_make(side);
+      pos.m_wolf[side_opp(sd)] = (m_count[sd] != 0) ? int(square_opp(square_make(m_wolf[sd]))) : -1;
+      pos.m_count[side_opp(sd)] = m_count[sd];
+   }
+
+   return pos;
+}
+
+void Pos::set_wolf(Side sd, Square sq, int count) {
+
+   assert(var::Variant == var::Frisian);
+   assert(count >= 0 && count <= 3);
+   assert(count == 0 || (is_piece(sq, King) && is_side(sq, sd)));
+
+   m_wolf[sd] = (count != 0) ? int(sq) : -1;
+   m_count[sd] = count;
+}
+
 bool operator==(const Pos & p0, const Pos & p1) { // for repetition detection
 
    if (p0.m_all != p1.m_all) return false;
@@ -33,6 +33,9 @@ public:
    friend bool operator == (const Pos & p0, const Pos & p1);
 
    Pos succ (Move mv) const;
+   Pos flip () const; // 180 degree rotation with colours swapped
+
+   void set_wolf (Side sd, Square sq, int count); // Frisian, for bitbase decoding
 
    Side turn () const { return m_turn; }
 
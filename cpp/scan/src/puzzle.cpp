@@ -0,0 +1,428 @@
+
+// includes
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "bb_base.hpp"
+#include "common.hpp"
+#include "eval.hpp"
+#include "fen.hpp"
+#include "gen.hpp"
+#include "hash.hpp"
+#include "hub.hpp"
+#include "libmy.hpp"
+#include "list.hpp"
+#include "move.hpp"
+#include "pos.hpp"
+#include "puzzle.hpp"
+#include "score.hpp"
+#include "search.hpp"
+#include "thread.hpp"
+#include "util.hpp"
+#include "var.hpp"
+
+namespace puzzle {
+
+// constants
+
+const int Screen_Depth {3}; // stage 1, quiet plies (captures and forced moves are free)
+const int Check_Depth  {5}; // stage 2, per root move
+
+const int Gain_Min {150}; // over the QS score, for the best move
+const int Alt_Gain {50};  // ... at most, for any other move
+const int Gap_Min  {100}; // engine: best move vs. the best alternative
+const int Win_Min  {150}; // engine: score after the solution, saving moves are not puzzles
+
+// types
+
+struct Item { // position from a game
+   int game;
+   int ply;
+   Pos pos;
+};
+
+struct Candidate {
+   Item item;
+   Score base; // QS
+   Move move;
+   Score score;
+   Score alt; // best other move
+};
+
+// prototypes
+
+static bool parse_game (const std::string & line, std::vector<Item> & items, int game);
+
+static int   screen  (const Item & item, Candidate & cand, int64 & node);
+static Score shallow (const Pos & pos, Score alpha, Score beta, int depth, Ply ply, int64 & node);
+
+static bool verify    (Candidate & cand, Line & pv, Depth depth);
+static bool bb_verify (const Candidate & cand, const Line & pv, std::string & result);
+
+static Search_Output search_depth (const Pos & pos, Depth depth);
+
+static std::string score_string (Score sc);
+
+// functions
+
+void mine(const std::string & games_file, const std::string & output_file, int threads, Depth depth) {
+
+   // read games
+
+   std::ifstream in(games_file);
+
+   if (!in) {
+      std::cerr << "unable to open file \"" << games_file << "\"" << std::endl;
+      std::exit(EXIT_FAILURE);
+   }
+
+   std::vector<Item> items;
+
+   int games = 0; // game lines read, rejected ones included, so numbers match the input
+   int bad = 0;
+
+   std::string line;
+
+   while (std::getline(in, line)) {
+
+      line = ml::trim(line);
+      if (line.empty() || line[0] == '#') continue;
+
+      if (!parse_game(line, items, games)) bad += 1;
+      games += 1;
+   }
+
+   std::cout << games - bad << " games (" << bad << " rejected), " << items.size() << " positions" << std::endl;
+
+   // stages 1 and 2: own QS/shallow search, thread safe
+
+   std::vector<Candidate> cands;
+   Lockable sync;
+
+   std::atomic<int> next {0};
+   std::atomic<int64> nodes {0};
+   std::atomic<int> stage_1 {0}; // passed the screen
+
+   Timer timer;
+   timer.start();
+
+   auto worker = [&]() {
+
+      int64 node = 0;
+
+      while (true) {
+
+         int i = next.fetch_add(1);
+         if (i >= int(items.size())) break;
+
+         Candidate cand;
+         int stage = screen(items[i], cand, node);
+
+         if (stage >= 1) stage_1 += 1;
+
+         if (stage == 2) {
+            sync.lock();
+            cands.push_back(cand);
+            sync.unlock();
+         }
+      }
+
+      nodes += node;
+   };
+
+   std::vector<std::thread> pool;
+
+   for (int i = 0; i < threads; i++) {
+      pool.emplace_back(worker);
+   }
+
+   for (std::thread & thread : pool) {
+      thread.join();
+   }
+
+   timer.stop();
+   double time = timer.elapsed();
+
+   std::cout << "screen: " << ml::ftos(time, 2) << " s, " << ml::ftos(double(items.size()) / std::max(time, 1E-9) / double(threads), 0) << " positions/s/core";
+   std::cout << ", " << ml::ftos(double(nodes) / std::max(time, 1E-9) / 1E6, 2) << " M nodes/s" << std::endl;
+   std::cout << "stage 1 (depth " << Screen_Depth << "): " << stage_1 << ", stage 2 (multi-PV depth " << Check_Depth << "): " << cands.size() << std::endl;
+
+   // stage 3: engine search and uniqueness, sequential (the search is global)
+
+   std::sort(cands.begin(), cands.end(), [](const Candidate & c0, const Candidate & c1) {
+      return (c0.item.game != c1.item.game) ? c0.item.game < c1.item.game : c0.item.ply < c1.item.ply;
+   });
+
+   std::ofstream out(output_file);
+
+   if (!out) {
+      std::cerr << "unable to open file \"" << output_file << "\"" << std::endl;
+      std::exit(EXIT_FAILURE);
+   }
+
+   std::unordered_set<uint64> seen;
+
+   int puzzles = 0;
+   int rejected_bb = 0;
+
+   timer.reset();
+   timer.start();
+
+   for (Candidate & cand : cands) {
+
+      if (!seen.insert(uint64(hash::key(cand.item.pos))).second) continue; // transposition
+
+      Line pv;
+      if (!verify(cand, pv, depth)) continue;
+
+      std::string bb = "none";
+
+      if (!bb_verify(cand, pv, bb)) {
+         rejected_bb += 1;
+         continue;
+      }
+
+      std::string text = "puzzle";
+      hub::add_pair(text, "game", cand.item.game + 1);
+      hub::add_pair(text, "ply", cand.item.ply);
+      hub::add_pair(text, "pos", pos_hub(cand.item.pos));
+      hub::add_pair(text, "move", move::to_hub(cand.move, cand.item.pos));
+      hub::add_pair(text, "score", score_string(cand.score));
+      hub::add_pair(text, "alt", score_string(cand.alt));
+      hub::add_pair(text, "base", score_string(cand.base));
+      hub::add_pair(text, "pv", pv.to_hub(cand.item.pos));
+      hub::add_pair(text, "bb", bb);
+
+      out << text << '\n';
+      puzzles += 1;
+   }
+
+   timer.stop();
+
+   std::cout << "stage 3 (engine depth " << depth << "): " << ml::ftos(timer.elapsed(), 2) << " s, " << puzzles << " puzzles";
+   if (rejected_bb != 0) std::cout << " (" << rejected_bb << " refuted by bitbases)";
+   std::cout << std::endl;
+
+   std::cout << "wrote \"" << output_file << "\"" << std::endl;
+}
+
+static bool parse_game(const std::string & line, std::vector<Item> & items, int game) {
+
+   std::vector<Item> game_items;
+
+   try {
+
+      std::stringstream ss(line);
+      std::string token;
+
+      Pos pos = pos::Start;
+      bool first = true;
+
+      while (ss >> token) {
+
+         if (first && token.size() == Dense_Size + 1) { // start position
+            pos = pos_from_hub(token);
+            first = false;
+            continue;
+         }
+
+         first = false;
+
+         if (token.back() == '.') continue; // move number
+         if (token == "*" || token == "2-0" || token == "0-2" || token == "1-1") continue; // result
+
+         Move mv = move::from_string(token, pos); // also with intermediate squares
+         if (mv == move::None || !move::is_legal(mv, pos)) return false;
+
+         game_items.push_back({game, int(game_items.size()), pos});
+         pos = pos.succ(mv);
+      }
+
+      if (!pos::is_end(pos)) game_items.push_back({game, int(game_items.size()), pos});
+
+   } catch (const Bad_Input &) {
+
+      return false;
+   }
+
+   items.insert(items.end(), game_items.begin(), game_items.end());
+   return true;
+}
+
+static int screen(const Item & item, Candidate & cand, int64 & node) { // stages 1 and 2, returns the last one passed
+
+   const Pos & pos = item.pos;
+
+   cand.item = item;
+
+   // a quiet choice: forced captures make poor puzzles
+
+   if (pos::is_capture(pos)) return 0;
+
+   List list;
+   gen_moves(list, pos);
+   if (list.size() < 2) return 0;
+
+   // stage 1: does a shallow search gain material over QS?
+
+   Score base = shallow(pos, -score::Inf, +score::Inf, 0, Ply_Root, node);
+   if (!score::is_eval(base)) return 0;
+
+   Score sc = shallow(pos, base + Score(Gain_Min - 1), base + Score(Gain_Min), Screen_Depth, Ply_Root, node); // null window
+   if (sc < base + Gain_Min) return 0;
+
+   // stage 2: per-move scores, exactly one move must win
+
+   Move best_move = move::None;
+   Score best = -score::Inf;
+   Score alt = -score::Inf;
+
+   for (Move mv : list) {
+
+      Score new_sc = -shallow(pos.succ(mv), -score::Inf, +score::Inf, Check_Depth - 1, Ply(1), node);
+
+      if (new_sc > best) {
+         alt = best;
+         best = new_sc;
+         best_move = mv;
+      } else if (new_sc > alt) {
+         alt = new_sc;
+      }
+
+      if (alt >= base + Alt_Gain) return 1; // two winning moves
+   }
+
+   if (best < base + Gain_Min) return 1;
+
+   cand.base = base;
+   cand.move = best_move;
+   cand.score = best;
+   cand.alt = alt;
+
+   return 2;
+}
+
+static Score shallow(const Pos & pos, Score alpha, Score beta, int depth, Ply ply, int64 & node) {
+
+   assert(-score::Inf <= alpha && alpha < beta && beta <= +score::Inf);
+
+   node += 1;
+
+   bool capture = pos::is_capture(pos);
+
+   if (ply >= Ply_Max) return eval(pos);
+   if (depth <= 0 && !capture) return eval(pos); // QS stand pat
+
+   List list;
+   gen_moves(list, pos);
+
+   if (list.size() == 0) return score::loss(ply);
+
+   int new_depth = (capture || list.size() == 1) ? depth : depth - 1; // forced moves are free
+
+   Score bs = score::None;
+
+   for (Move mv : list) {
+
+      Score sc = -shallow(pos.succ(mv), -beta, -std::max(alpha, bs), new_depth, ply + Ply(1), node);
+
+      if (sc > bs) {
+         bs = sc;
+         if (sc >= beta) break;
+      }
+   }
+
+   return bs;
+}
+
+static bool verify(Candidate & cand, Line & pv, Depth depth) { // stage 3, engine search
+
+   const Pos & pos = cand.item.pos;
+
+   Search_Output so = search_depth(pos, depth);
+
+   if (so.move != cand.move) return false; // the engine prefers something else
+   if (so.score < cand.base + Gain_Min || so.score < Win_Min) return false;
+
+   // uniqueness: every other move searched separately
+
+   List list;
+   gen_moves(list, pos);
+
+   Score alt = -score::Inf;
+
+   for (Move mv : list) {
+
+      if (mv == so.move) continue;
+
+      Pos new_pos = pos.succ(mv);
+      if (pos::is_end(new_pos)) return false; // another move wins at once
+
+      Search_Output child = search_depth(new_pos, depth - Depth(1));
+      alt = std::max(alt, Score(-child.score));
+
+      if (alt > so.score - Gap_Min || alt >= cand.base + Gain_Min) return false;
+   }
+
+   cand.score = so.score;
+   cand.alt = alt;
+   pv = so.pv;
+
+   return true;
+}
+
+static bool bb_verify(const Candidate & cand, const Line & pv, std::string & result) {
+
+   if (!var::BB) return true;
+
+   // first position along the solution that the bitbases know
+
+   Pos pos = cand.item.pos;
+   Side sd = pos.turn();
+
+   for (Move mv : pv) {
+
+      pos = pos.succ(mv);
+
+      if (bb::pos_is_known(pos) && !pos::is_end(pos)) {
+
+         int val = bb::probe(pos);
+         if (pos.turn() != sd) val = (val == bb::Win) ? bb::Loss : (val == bb::Loss) ? bb::Win : val;
+
+         result = bb::value_to_string(val);
+         return val != bb::Loss; // a draw still wins material
+      }
+   }
+
+   return true;
+}
+
+static Search_Output search_depth(const Pos & pos, Depth depth) {
+
+   Search_Input si;
+   si.move = false;
+   si.book = false;
+   si.depth = depth;
+   si.output = Output_None;
+
+   Search_Output so;
+   search(so, Node(pos), si);
+
+   return so;
+}
+
+static std::string score_string(Score sc) {
+   return ml::ftos(double(sc) / 100.0, 2);
+}
+
+} // namespace puzzle
+
@@ -0,0 +1,24 @@
+
+#ifndef PUZZLE_HPP
+#define PUZZLE_HPP
+
+// includes
+
+#include <string>
+
+#include "common.hpp"
+#include "libmy.hpp"
+
+namespace puzzle {
+
+// functions
+
+// games: one per line, moves from the start position (or a hub position first)
+// stages: QS/shallow screen and shallow multi-PV in parallel, then engine search and bitbases
+
+void mine (const std::string & games_file, const std::string & output_file, int threads, Depth depth);
+
+} // namespace puzzle
+
+#endif // !defined PUZZLE_HPP
+
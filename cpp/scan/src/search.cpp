@@ -10,7 +10,9 @@
 #include <string>
 
 #include "bb_base.hpp"
+#include "bb_comp.hpp"
 #include "book.hpp"
+#include "cluster.hpp"
 #include "common.hpp"
 #include "eval.hpp"
 #include "gen.hpp"
@@ -18,38 +20,25 @@
 #include "hub.hpp"
 #include "libmy.hpp"
 #include "list.hpp"
+#include "logger.hpp"
 #include "move.hpp"
 #include "pos.hpp"
 #include "score.hpp"
 #include "search.hpp"
 #include "sort.hpp"
 #include "thread.hpp"
+#include "timeman.hpp"
 #include "tt.hpp"
+#include "tune.hpp"
 #include "var.hpp"
 
-// types
-
-enum ID : int { ID_Main = 0 };
-
-class Time {
-
-private:
-
-   double m_time_0; // target
-   double m_time_1; // extended
-
-public:
+// constants
 
-   void init (const Search_Input & si, const Pos & pos);
+const int Proven_Iter {3}; // iterations with the same proven score and move before stopping
 
-   double time_0 () const { return m_time_0; }
-   double time_1 () const { return m_time_1; }
-
-private:
+// types
 
-   void init (double time);
-   void init (int moves, double time, double inc, const Pos & pos);
-};
+enum ID : int { ID_Main = 0 };
 
 struct Local {
 
@@ -95,6 +84,7 @@ private:
    Search_Global * m_sg;
 
    Local m_local;
+   ml::Array<Move, cluster::Size_Max> m_retry; // root moves handed back by lost cluster workers
 
    std::atomic<int> m_workers;
    std::atomic<bool> m_stop;
@@ -108,8 +98,11 @@ public:
    void enter ();
    void leave ();
 
-   Move get_move (Local & local);
-   void update   (Move mv, Score sc, const Line & pv);
+   Move get_move (Local & local, SMP_Stats & smp);
+   void update   (Move mv, Score sc, const Line & pv, SMP_Stats & smp);
+   void retry    (Move mv);
+
+   bool has_retry () const;
 
    void stop_root ();
 
@@ -120,6 +113,11 @@ public:
 
    Split_Point * parent () const { return m_parent; }
    const Local & local  () const { return m_local; }
+
+private:
+
+   void lock (SMP_Stats & smp);
+   using Lockable::lock;
 };
 
 class Search_Local : public Lockable {
@@ -141,6 +139,11 @@ private:
    int64 m_node;
    int64 m_leaf;
    int64 m_ply_sum;
+   int64 m_cut;
+   int64 m_cut_first;
+   SMP_Stats m_smp;
+
+   bool m_bb_miss; // a QS leaf was not resident in the bitbases
 
 public:
 
@@ -185,7 +188,7 @@ private:
    Score leaf      (Score sc, Ply ply);
    void  mark_leaf (Ply ply);
 
-   static Score bb_probe (const Pos & pos, Ply ply);
+   bool bb_probe (const Pos & pos, Ply ply, Score & sc) const; // resident slices only
 
    void poll ();
    bool stop () const;
@@ -196,6 +199,43 @@ private:
    Split_Point * top_sp () const;
 };
 
+class Search_Remote { // proxy thread for a cluster worker
+
+private:
+
+   std::thread m_thread;
+   int m_worker;
+
+   std::atomic<Split_Point *> m_work;
+
+   Search_Global * m_sg;
+
+   std::atomic<int64> m_node;
+   SMP_Stats m_smp;
+
+public:
+
+   void init (int worker, Search_Global & sg);
+   void end  ();
+
+   void end_iter (Search_Output & so);
+
+   void give_work (Split_Point * sp);
+
+   bool idle () const;
+
+private:
+
+   static void launch (Search_Remote * sr, Split_Point * root_sp);
+
+   void idle_loop (Split_Point * wait_sp);
+   void move_loop (Split_Point * sp);
+
+   bool search_move (Move mv, const Local & local, Split_Point * sp, Score & sc, Line & pv);
+
+   static bool stop (Split_Point * sp);
+};
+
 class Search_Global : public Lockable {
 
 private:
@@ -209,6 +249,7 @@ private:
    int m_bb_size;
 
    Search_Local m_sl[16];
+   Search_Remote m_sr[cluster::Size_Max];
 
    Split_Point m_root_sp;
 
@@ -221,6 +262,9 @@ private:
    Score m_last_score;
 
    double m_factor;
+   int m_changes; // best-move changes in this iteration
+
+   std::atomic<int64> m_root_node[Move_Index_Size]; // per root move, this iteration
 
 public:
 
@@ -236,6 +280,7 @@ public:
    void abort ();
 
    bool has_worker () const;
+   bool has_remote () const;
    void broadcast  (Split_Point * sp);
 
    List & list () { return m_list; } // HACK
@@ -252,6 +297,10 @@ public:
    Score last_score () const { return m_last_score; }
 
    double factor () const { return m_factor; }
+   int changes () const { return m_changes; }
+
+   void   add_root_node (Move mv, int64 node);
+   double root_share    (Move mv, int64 node) const;
 
    int bb_size () const { return m_bb_size; }
 
@@ -270,7 +319,8 @@ class Abort : public std::exception {};
 
 // variables
 
-static Time G_Time;
+static const timeman::Policy G_Policy {}; // engine defaults, see "scan time-sim"
+static timeman::Time G_Time;
 
 static SMP G_SMP; // lock to create and broadcast split points
 static Lockable G_IO;
@@ -279,11 +329,9 @@ static Lockable G_IO;
 
 inline int depth_min () { return (var::Variant == var::Losing) ? 6 : 12; }
 
-static void gen_moves_bb (List & list, const Pos & pos);
-
-static double lerp (double mg, double eg, double phase);
+static bool is_proven (Score sc, Depth depth);
 
-static double time_lag (double time);
+static bool gen_moves_bb (List & list, const Pos & pos);
 
 static void local_update (Local & local, Move mv, Score sc, const Line & pv, Search_Global & sg);
 
@@ -296,9 +344,12 @@ void search(Search_Output & so, const Node & node, const Search_Input & si) {
    // init
 
    var::update();
+   tune::update();
 
    so.init(si, node);
 
+   bb::promote();
+
    int bb_size = var::BB_Size;
 
    if (bb::pos_is_load(node)) { // root position already in bitbases => only use smaller bitbases in search
@@ -309,9 +360,11 @@ void search(Search_Output & so, const Node & node, const Search_Input & si) {
    // special cases
 
    List list;
-   gen_moves_bb(list, node);
+   bool bb_root = gen_moves_bb(list, node);
    assert(list.size() != 0);
 
+   bool bb_draw = bb_root && bb::probe(node) == bb::Draw; // every root move keeps the draw
+
    if (si.move && !si.ponder && list.size() == 1) {
 
       Move mv = list[0];
@@ -339,30 +392,57 @@ void search(Search_Output & so, const Node & node, const Search_Input & si) {
 
    // more init
 
-   G_Time.init(si, node);
+   G_Time.init(si, node, G_Policy);
+
+   timeman::Trace trace;
+   trace.start(si, node, Depth(depth_min()));
+
+   int64 bb_skipped = bb::probes_skipped();
 
    Search_Global sg;
    sg.init(si, so, node, list, bb_size); // also launches threads
 
    // iterative deepening
 
+   Move proven_move = move::None;
+   Score proven_score = score::None;
+   int proven_iter = 0;
+
    try {
 
       for (int d = 1; d <= si.depth; d++) {
 
          Depth depth = Depth(d);
 
+         int64 node_0 = so.node;
+
          sg.search(depth);
          sg.collect_stats();
 
+         double share = sg.root_share(so.move, so.node - node_0);
+         trace.iter(depth, so.time(), so.move, so.score, share, sg.changes());
+
          // early exit?
 
          bool abort = false;
 
-         if (si.smart && so.time() >= G_Time.time_0() * sg.factor() * lerp(0.4, 0.8, pos::phase(node))) {
+         if (si.smart && so.time() >= G_Time.time_0() * sg.factor() * G_Policy.exit(pos::phase(node), share)) {
             abort = true;
          }
 
+         // proven result? deeper iterations can only confirm it, also in analysis
+
+         if (so.move == proven_move && so.score == proven_score) {
+            proven_iter += 1;
+         } else {
+            proven_move = so.move;
+            proven_score = so.score;
+            proven_iter = 1;
+         }
+
+         if (proven_iter >= Proven_Iter && is_proven(so.score, depth)) abort = true;
+         if (bb_draw) abort = true;
+
          if (depth >= depth_min() && abort) {
             sg.set_flag();
             if (!sg.ponder()) break;
@@ -373,10 +453,24 @@ void search(Search_Output & so, const Node & node, const Search_Input & si) {
 
    }
 
-   if (si.output == Output_Terminal) std::cout << std::endl;
+   if (si.output == Output_Terminal) logger::put(logger::Level::Info, "");
 
    sg.end(); // sync with threads
    so.end();
+
+   trace.end(so.time(), so.move);
+   bb::usage_save(); // "bb-usage" only
+
+   bb_skipped = bb::probes_skipped() - bb_skipped;
+
+   if (bb_skipped != 0 && si.output == Output_Hub) { // "bb-lazy" only
+      std::string line = "info";
+      hub::add_pair(line, "bb-skipped", std::to_string(bb_skipped));
+      hub::add_pair(line, "bb-loaded", std::to_string(bb::shards_loaded()));
+      hub::write(line);
+   }
+
+   logger::flush(); // before the caller prints anything
 }
 
 Move quick_move(const Pos & pos) {
@@ -446,7 +540,17 @@ Score quick_score(const Pos & pos) {
    return score::None;
 }
 
-static void gen_moves_bb(List & list, const Pos & pos) {
+static bool is_proven(Score sc, Depth depth) {
+
+   if (score::is_eval(sc)) return false;
+
+   Score abs = Score(std::abs(sc));
+   if (abs <= score::BB_Inf) return true; // bitbase result, proven once converted
+
+   return int(depth) >= int(score::Inf - abs); // mate: the full line fits in the nominal depth
+}
+
+static bool gen_moves_bb(List & list, const Pos & pos) { // true if filtered by bitbases
 
    if (bb::pos_is_load(pos)) { // root position already in bitbases
 
@@ -459,21 +563,32 @@ static void gen_moves_bb(List & list, const Pos & pos) {
       List tmp;
       gen_moves(tmp, pos);
 
+      if (node == bb::Unknown) { // partial set, a capture leads to a missing slice
+         list = tmp;
+         return false;
+      }
+
       for (Move mv : tmp) {
-         if (bb::value_age(bb::probe(pos.succ(mv))) == node) list.add(mv); // optimal move
+
+         int child = bb::probe(pos.succ(mv));
+
+         if (child == bb::Unknown) { // partial set, no filtering
+            list = tmp;
+            return false;
+         }
+
+         if (bb::value_age(child) == node) list.add(mv); // optimal move
       }
 
+      return true;
+
    } else {
 
       gen_moves(list, pos);
+      return false;
    }
 }
 
-static double lerp(double mg, double eg, double phase) {
-   assert(phase >= 0.0 && phase <= 1.0);
-   return mg + (eg - mg) * phase;
-}
-
 void Search_Input::init() {
 
    move = true;
@@ -497,6 +612,57 @@ void Search_Input::set_time(int moves, double time, double inc) {
    this->inc = inc;
 }
 
+void Search_Input::set_level(hub::Scanner & scan) {
+
+   int depth = -1;
+   int64 nodes = -1;
+   double move_time = -1.0;
+
+   bool smart = false;
+   int moves = 0;
+   double game_time = 30.0;
+   double inc = 0.0;
+
+   while (!scan.eos()) {
+
+      auto p = scan.get_pair();
+
+      if (false) {
+      } else if (p.name == "depth") {
+         depth = std::stoi(p.value);
+      } else if (p.name == "nodes") {
+         nodes = std::stoll(p.value);
+      } else if (p.name == "move-time") {
+         move_time = std::stod(p.value);
+      } else if (p.name == "moves") {
+         smart = true;
+         moves = std::stoi(p.value);
+      } else if (p.name == "time") {
+         smart = true;
+         game_time = std::stod(p.value);
+      } else if (p.name == "inc") {
+         smart = true;
+         inc = std::stod(p.value);
+      }
+      // "infinite" and "ponder" are ignored
+   }
+
+   if (depth >= 0) this->depth = Depth(depth);
+   if (nodes >= 0) this->nodes = nodes;
+   if (move_time >= 0.0) this->time = move_time;
+
+   if (smart) set_time(moves, game_time, inc);
+}
+
+void SMP_Stats::add(const SMP_Stats & stats) {
+   split += stats.split;
+   join += stats.join;
+   lock += stats.lock;
+   lock_wait += stats.lock_wait;
+   wait += stats.wait;
+   spin += stats.spin;
+}
+
 void Search_Output::init(const Search_Input & si, const Pos & pos) {
 
    m_si = &si;
@@ -515,6 +681,11 @@ void Search_Output::init(const Search_Input & si, const Pos & pos) {
    node = 0;
    leaf = 0;
    ply_sum = 0;
+   cut = 0;
+   cut_first = 0;
+   smp = SMP_Stats();
+
+   first_time = -1.0;
 }
 
 void Search_Output::end() {
@@ -528,7 +699,7 @@ void Search_Output::new_best_move(Move mv, Score sc) {
 
    new_best_move(mv, sc, Flag::Exact, Depth(0), pv);
 
-   if (m_si->output == Output_Terminal) std::cout << std::endl;
+   if (m_si->output == Output_Terminal) logger::put(logger::Level::Info, "");
 }
 
 void Search_Output::new_best_move(Move mv, Score sc, Flag flag, Depth depth, const Line & pv) {
@@ -547,6 +718,8 @@ void Search_Output::new_best_move(Move mv, Score sc, Flag flag, Depth depth, con
    double time = this->time();
    double speed = (time < 0.01) ? 0.0 : double(node) / time;
 
+   if (first_time < 0.0) first_time = time;
+
    switch (m_si->output) {
 
       case Output_None :
@@ -554,11 +727,14 @@ void Search_Output::new_best_move(Move mv, Score sc, Flag flag, Depth depth, con
          // no-op
          break;
 
-      case Output_Terminal :
+      case Output_Terminal : {
+
+         char line[64];
+         std::snprintf(line, sizeof(line), "%2d/%4.1f%+7.2f%11ld%7.2f%5.1f  ", depth, ply_avg(), double(score) / 100.0, node, time, speed / 1E6);
+         logger::put(logger::Level::Info, line + pv.to_string(m_pos, 7));
 
-         std::printf("%2d/%4.1f%+7.2f%11ld%7.2f%5.1f  %s\n", depth, ply_avg(), double(score) / 100.0, node, time, speed / 1E6, pv.to_string(m_pos, 7).c_str());
-         std::fflush(stdout);
          break;
+      }
 
       case Output_Hub : {
 
@@ -566,7 +742,7 @@ void Search_Output::new_best_move(Move mv, Score sc, Flag flag, Depth depth, con
          if (depth != 0)           hub::add_pair(line, "depth", std::to_string(depth));
          if (ply_avg() != 0.0)     hub::add_pair(line, "mean-depth", ml::ftos(ply_avg(), 1));
          if (score != score::None) hub::add_pair(line, "score", ml::ftos(double(score) / 100.0, 2));
-         if (node != 0)            hub::add_pair(line, "nodes", std::to_string(node));
+         if (node != 0)            hub::add_pair(line, "nodes", node);
          if (time >= 0.001)        hub::add_pair(line, "time", ml::ftos(time, 3));
          if (speed != 0.0)         hub::add_pair(line, "nps", ml::ftos(speed / 1E6, 1));
          if (pv.size() != 0)       hub::add_pair(line, "pv", pv.to_hub(m_pos));
@@ -587,48 +763,6 @@ double Search_Output::time() const {
    return m_timer.elapsed();
 }
 
-void Time::init(const Search_Input & si, const Pos & pos) {
-
-   if (si.smart) {
-      init(si.moves, si.time, si.inc, pos);
-   } else {
-      init(si.time);
-   }
-}
-
-void Time::init(double time) {
-   m_time_0 = time;
-   m_time_1 = time;
-}
-
-void Time::init(int moves, double time, double inc, const Pos & pos) {
-
-   double moves_left = lerp(30.0, 10.0, pos::phase(pos));
-   if (moves != 0) moves_left = std::min(moves_left, double(moves));
-
-   double factor = 1.3;
-   if (var::Ponder) factor *= 1.2;
-
-   double total = std::max(time + inc * moves_left, 0.0);
-   double alloc = total / moves_left * factor;
-
-   if (moves > 1) { // save some time for the following moves
-      double total_safe = std::max((time / double(moves - 1) + inc - (time / double(moves) + inc) * 0.5) * double(moves - 1), 0.0);
-      total = std::min(total, total_safe);
-   }
-
-   double max = time_lag(std::min(total, time + inc) * 0.95);
-
-   m_time_0 = std::min(time_lag(alloc), max);
-   m_time_1 = std::min(time_lag(alloc * 4.0), max);
-
-   assert(0.0 <= m_time_0 && m_time_0 <= m_time_1);
-}
-
-static double time_lag(double time) {
-   return std::max(time - 0.1, 0.0);
-}
-
 void Search_Global::init(const Search_Input & si, Search_Output & so, const Node & node, const List & list, int bb_size) {
 
    m_si = &si;
@@ -646,6 +780,7 @@ void Search_Global::init(const Search_Input & si, Search_Output & so, const Node
    m_last_score = score::None;
 
    m_factor = 1.0;
+   m_changes = 0;
 
    // new search
 
@@ -658,6 +793,10 @@ void Search_Global::init(const Search_Input & si, Search_Output & so, const Node
       sl(ID(id)).init(ID(id), *this); // also launches a thread if id /= 0
    }
 
+   for (int i = 0; i < cluster::size(); i++) {
+      m_sr[i].init(i, *this);
+   }
+
    G_TT.inc_date();
    sort_clear();
 }
@@ -667,10 +806,17 @@ void Search_Global::collect_stats() {
    m_so->node = 0;
    m_so->leaf = 0;
    m_so->ply_sum = 0;
+   m_so->cut = 0;
+   m_so->cut_first = 0;
+   m_so->smp = SMP_Stats();
 
    for (int id = 0; id < var::Threads; id++) {
       sl(ID(id)).end_iter(*m_so);
    }
+
+   for (int i = 0; i < cluster::size(); i++) {
+      m_sr[i].end_iter(*m_so);
+   }
 }
 
 void Search_Global::end() {
@@ -683,11 +829,20 @@ void Search_Global::end() {
    for (int id = 0; id < var::Threads; id++) {
       sl(ID(id)).end();
    }
+
+   for (int i = 0; i < cluster::size(); i++) {
+      m_sr[i].end();
+   }
 }
 
 void Search_Global::search(Depth depth) {
 
    m_depth = depth;
+   m_changes = 0;
+
+   for (Move mv : m_list) {
+      m_root_node[move::index(mv, *m_node)] = 0;
+   }
 
    for (int id = 0; id < var::Threads; id++) {
       sl(ID(id)).start_iter();
@@ -701,7 +856,7 @@ void Search_Global::search(Depth depth) {
    Score sc = m_so->score;
 
    if (m_si->smart && depth > 1 && mv == m_last_move) {
-      m_factor = std::max(m_factor * 0.9, 0.6);
+      m_factor = G_Policy.factor_stable(m_factor);
    }
 
    m_last_move = mv;
@@ -723,16 +878,25 @@ void Search_Global::new_best_move(Move mv, Score sc, Flag flag, Depth depth, con
    if (depth > 1 && mv != bm) {
 
       m_flag = false;
+      m_changes += 1;
 
       if (m_si->smart) {
-         m_factor = std::max(m_factor, 1.0);
-         m_factor = std::min(m_factor * 1.2, 2.0);
+         m_factor = G_Policy.factor_change(m_factor);
       }
    }
 
    if (var::SMP) unlock();
 }
 
+void Search_Global::add_root_node(Move mv, int64 node) {
+   m_root_node[move::index(mv, *m_node)] += node;
+}
+
+double Search_Global::root_share(Move mv, int64 node) const {
+   if (mv == move::None || node == 0) return 0.0;
+   return double(m_root_node[move::index(mv, *m_node)]) / double(node);
+}
+
 void Search_Global::poll() {
 
    bool abort = false;
@@ -753,7 +917,7 @@ void Search_Global::poll() {
 
       if (command == "ping") {
          get_line(line);
-         std::cout << "pong" << std::endl;
+         logger::put(logger::Level::Reply, "pong");
       } else if (command == "ponder-hit") {
          get_line(line);
          m_ponder = false;
@@ -801,11 +965,26 @@ bool Search_Global::has_worker() const {
    return false;
 }
 
+bool Search_Global::has_remote() const {
+
+   if (G_SMP.busy) return false;
+
+   for (int i = 0; i < cluster::size(); i++) {
+      if (m_sr[i].idle()) return true;
+   }
+
+   return false;
+}
+
 void Search_Global::broadcast(Split_Point * sp) {
 
    for (int id = 0; id < var::Threads; id++) {
       sl(ID(id)).give_work(sp);
    }
+
+   for (int i = 0; i < cluster::size(); i++) {
+      m_sr[i].give_work(sp);
+   }
 }
 
 void Search_Local::init(ID id, Search_Global & sg) {
@@ -821,6 +1000,11 @@ void Search_Local::init(ID id, Search_Global & sg) {
    m_node = 0;
    m_leaf = 0;
    m_ply_sum = 0;
+   m_cut = 0;
+   m_cut_first = 0;
+   m_smp = SMP_Stats();
+
+   m_bb_miss = false;
 
    if (var::SMP && m_id != ID_Main) m_thread = std::thread(launch, this, sg.root_sp());
 }
@@ -845,6 +1029,9 @@ void Search_Local::end_iter(Search_Output & so) {
       so.node += m_node;
       so.leaf += m_leaf;
       so.ply_sum += m_ply_sum;
+      so.cut += m_cut;
+      so.cut_first += m_cut_first;
+      so.smp.add(m_smp);
    }
 }
 
@@ -857,12 +1044,24 @@ void Search_Local::idle_loop(Split_Point * wait_sp) {
       assert(m_work == m_sg->root_sp());
       m_work = nullptr;
 
+      Timer timer;
+      timer.start();
+
       while (!wait_sp->free() && m_work.load() == nullptr) // spin
          ;
 
+      timer.stop();
+
+      if (wait_sp == m_sg->root_sp()) {
+         m_smp.spin += timer.elapsed();
+      } else {
+         m_smp.wait += timer.elapsed();
+      }
+
       Split_Point * work = m_work.exchange(m_sg->root_sp()); // to make it non-null
       if (work == nullptr) break;
 
+      m_smp.join += 1;
       join(work);
    }
 
@@ -937,7 +1136,7 @@ void Search_Local::move_loop(Split_Point * sp) {
 
    while (true) {
 
-      Move mv = sp->get_move(local); // also updates "local"
+      Move mv = sp->get_move(local, m_smp); // also updates "local"
       if (mv == move::None) break;
 
       if (mv != local.skip_move) {
@@ -945,7 +1144,7 @@ void Search_Local::move_loop(Split_Point * sp) {
          Line pv;
          Score sc = search_move(mv, local, pv);
 
-         sp->update(mv, sc, pv);
+         sp->update(mv, sc, pv, m_smp);
       }
    }
 }
@@ -962,7 +1161,7 @@ void Search_Local::search_asp(const Node & node, const List & list, Depth depth,
 
    if (depth >= 4 && score::is_eval(last_score)) {
 
-      int margin = (var::Variant == var::Normal) ? 10 : 20;
+      int margin = (var::Variant == var::Normal) ? tune::Asp_Margin_Normal : tune::Asp_Margin;
 
       int alpha_margin = margin;
       int beta_margin  = margin;
@@ -1107,16 +1306,22 @@ Score Search_Local::search(const Node & node, Score alpha, Score beta, Depth dep
 
    if (bb::pos_is_search(node, m_sg->bb_size())) {
 
+      m_bb_miss = false;
+
       Line new_pv;
       Score sc = qs(node, local.alpha, local.beta, Depth(0), local.ply, new_pv); // captures + BB probe
 
-      if ((sc < 0 && sc <= local.alpha) || sc == 0 || (sc > 0 && sc >= local.beta)) {
+      if (m_bb_miss) { // not a bitbase score
+
+         // no-op
+
+      } else if ((sc < 0 && sc <= local.alpha) || sc == 0 || (sc > 0 && sc >= local.beta)) {
+
          local.score = sc;
          local.pv = new_pv;
          goto cont;
-      }
 
-      if (sc > 0) { // win => lower bound
+      } else if (sc > 0) { // win => lower bound
          local.score = sc;
          local.pv = new_pv;
       }
@@ -1138,13 +1343,13 @@ Score Search_Local::search(const Node & node, Score alpha, Score beta, Depth dep
 
    if (local.prune
     && !local.pv_node
-    && local.depth >= 3
+    && local.depth >= tune::Prune_Depth
     && score::is_eval(local.beta)
     ) {
 
-      Score margin = Score(local.depth * 10);
+      Score margin = Score(local.depth * tune::Prune_Margin);
       Score new_beta = local.beta + margin;
-      Depth new_depth = Depth(local.depth * 40 / 100);
+      Depth new_depth = Depth(local.depth * tune::Prune_Red / 100);
 
       Line new_pv;
       Score sc = search(node, new_beta - Score(1), new_beta, new_depth, local.ply + Ply(1), false, move::None, new_pv);
@@ -1159,6 +1364,31 @@ Score Search_Local::search(const Node & node, Score alpha, Score beta, Depth dep
       }
    }
 
+   // forced move => play it without the move-loop machinery
+
+   if (local.list.size() == 1 && local.skip_move == move::None) {
+
+      Move mv = local.list[0];
+
+      Score new_alpha = std::max(local.alpha, local.score);
+      assert(new_alpha < local.beta);
+
+      inc_node();
+
+      Node new_node = node.succ(mv);
+
+      Line new_pv;
+      Score sc = -search(new_node, -local.beta, -new_alpha, local.depth, local.ply + Ply(1), local.prune, move::None, new_pv); // extended, see extend()
+
+      if (sc > local.score) {
+         local.move = mv;
+         local.score = sc;
+         local.pv.concat(mv, new_pv);
+      }
+
+      goto cont;
+   }
+
    // move loop
 
    sort_moves(local.list, node, tt_move);
@@ -1177,6 +1407,10 @@ cont : // epilogue
       Depth tt_depth = local.depth;
 
       G_TT.store(key, tt_move, tt_score, tt_flag, tt_depth);
+
+      if (tt_depth >= cluster::Share_Depth && cluster::is_active()) {
+         cluster::share(key, tt_move, tt_score, tt_flag, tt_depth);
+      }
    }
 
    // move-ordering statistics
@@ -1189,6 +1423,12 @@ cont : // epilogue
 
       good_move(local.move, node);
 
+      if (local.score >= local.beta) {
+         if (local.depth >= Depth(2)) sort_sample(local.move, node);
+         m_cut += 1;
+         if (local.move == local.list[0]) m_cut_first += 1;
+      }
+
       assert(list::has(local.list, local.move));
 
       for (Move mv : local.list) {
@@ -1213,11 +1453,10 @@ void Search_Local::move_loop(Local & local) {
       // SMP
 
       if (var::SMP
-       && local.depth >= 6
        && searched_size != 0
-       && local.list.size() - searched_size >= 5
-       && m_sg->has_worker()
        && m_pool_size < Pool_Size
+       && ((local.depth >= tune::SMP_Depth && local.list.size() - searched_size >= tune::SMP_Moves && m_sg->has_worker())
+        || (local.ply == Ply_Root && local.depth >= cluster::Split_Depth && m_sg->has_remote())) // root moves only
        ) {
          split(local);
          return;
@@ -1250,7 +1489,7 @@ Score Search_Local::search_move(Move mv, const Local & local, Line & pv) {
    if (ext != 0 && red != 0) red = Depth(0);
 
    if (local.pv_node
-    && local.depth >= 8
+    && local.depth >= tune::Sing_Depth
     && mv == local.sing_move
     && local.skip_move == move::None
     && ext == 0
@@ -1258,10 +1497,10 @@ Score Search_Local::search_move(Move mv, const Local & local, Line & pv) {
 
       assert(red == 0);
 
-      Score new_alpha = local.sing_score - Score(40);
+      Score new_alpha = local.sing_score - Score(tune::Sing_Margin);
 
       Line new_pv;
-      Score sc = search(node, new_alpha, new_alpha + Score(1), local.depth - Depth(4), local.ply, local.prune, mv, new_pv);
+      Score sc = search(node, new_alpha, new_alpha + Score(1), local.depth - Depth(tune::Sing_Red), local.ply, local.prune, mv, new_pv);
 
       if (sc <= new_alpha) ext = Depth(1);
    }
@@ -1275,6 +1514,8 @@ Score Search_Local::search_move(Move mv, const Local & local, Line & pv) {
 
    Score sc;
 
+   int64 node_0 = m_node;
+
    inc_node();
 
    Node new_node = local.node().succ(mv);
@@ -1292,6 +1533,8 @@ Score Search_Local::search_move(Move mv, const Local & local, Line & pv) {
       sc = -search(new_node, -local.beta, -new_alpha, new_depth, local.ply + Ply(1), local.prune, move::None, pv);
    }
 
+   if (local.ply == Ply_Root) m_sg->add_root_node(mv, m_node - node_0); // for time management
+
    assert(score::is_ok(sc));
    return sc;
 }
@@ -1321,12 +1564,20 @@ Score Search_Local::qs(const Node & node, Score alpha, Score beta, Depth depth,
    List list;
    gen_captures(list, node);
 
+   if (list.size() != 0 && bb::pos_is_search(node, m_sg->bb_size()) && bb::pos_is_resolved(node)) { // one lookup instead of a capture tree
+      Score sc;
+      if (bb_probe(node, ply, sc)) return leaf(sc, ply);
+      m_bb_miss = true; // search normally
+   }
+
    if (list.size() == 0) { // quiet position
 
       // bitbases
 
       if (bb::pos_is_search(node, m_sg->bb_size())) {
-         return leaf(bb_probe(node, ply), ply);
+         Score sc;
+         if (bb_probe(node, ply, sc)) return leaf(sc, ply);
+         m_bb_miss = true; // search normally
       }
 
       // threat position?
@@ -1376,6 +1627,8 @@ void Search_Local::split(Local & local) {
 
    G_SMP.lock(); // useful?
 
+   m_smp.split += 1;
+
    assert(!G_SMP.busy);
    G_SMP.busy = true;
 
@@ -1393,6 +1646,16 @@ void Search_Local::split(Local & local) {
    join(sp);
    idle_loop(sp);
 
+   if (sp->has_retry()) { // a cluster worker was lost after everyone else had left
+      push_sp(sp);
+      try {
+         move_loop(sp);
+      } catch (const Abort &) {
+         // no-op
+      }
+      pop_sp(sp);
+   }
+
    sp->get_result(local);
 
    assert(m_pool_size > 0);
@@ -1428,12 +1691,12 @@ Depth Search_Local::reduce(Move mv, const Local & local) { // LMR
 
    const Node & node = local.node();
 
-   if (local.depth >= 2
-    && local.j >= (local.pv_node ? 3 : 1)
+   if (local.depth >= tune::LMR_Depth
+    && local.j >= (local.pv_node ? tune::LMR_Moves_PV : tune::LMR_Moves)
     && !move::is_capture  (mv, node)
     && !move::is_promotion(mv, node)
     ) {
-      red = (!local.pv_node && local.j >= 4) ? 2 : 1;
+      red = (!local.pv_node && local.j >= tune::LMR_Moves_2) ? 2 : 1;
    }
 
    return Depth(red);
@@ -1465,13 +1728,15 @@ void Search_Local::mark_leaf(Ply ply) {
    m_ply_sum += ply;
 }
 
-Score Search_Local::bb_probe(const Pos & pos, Ply ply) {
+bool Search_Local::bb_probe(const Pos & pos, Ply ply, Score & sc) const {
 
-   switch (bb::probe_raw(pos)) {
-      case bb::Win :  return +score::BB_Inf - Score(ply);
-      case bb::Loss : return -score::BB_Inf + Score(ply);
-      case bb::Draw : return Score(0);
-      default :       assert(false); return Score(0);
+   assert(m_id < bb::Slot_Size);
+
+   switch (bb::probe_raw(pos, false, m_id)) { // never wait for storage, the miss is queued for loading
+      case bb::Win :  sc = +score::BB_Inf - Score(ply); return true;
+      case bb::Loss : sc = -score::BB_Inf + Score(ply); return true;
+      case bb::Draw : sc = Score(0); return true;
+      default :       return false;
    }
 }
 
@@ -1512,6 +1777,153 @@ Split_Point * Search_Local::top_sp() const {
    return m_stack[m_stack.size() - 1];
 }
 
+void Search_Remote::init(int worker, Search_Global & sg) {
+
+   m_worker = worker;
+
+   m_work = sg.root_sp(); // to make it non-null
+
+   m_sg = &sg;
+
+   m_node = 0;
+   m_smp = SMP_Stats();
+
+   m_thread = std::thread(launch, this, sg.root_sp());
+}
+
+void Search_Remote::launch(Search_Remote * sr, Split_Point * root_sp) {
+   sr->idle_loop(root_sp);
+}
+
+void Search_Remote::end() {
+   m_thread.join();
+}
+
+void Search_Remote::end_iter(Search_Output & so) {
+   so.node += m_node;
+   so.smp.add(m_smp);
+}
+
+void Search_Remote::idle_loop(Split_Point * wait_sp) {
+
+   while (true) {
+
+      assert(m_work == m_sg->root_sp());
+      m_work = nullptr;
+
+      while (!wait_sp->free() && m_work.load() == nullptr) {
+         std::this_thread::yield();
+      }
+
+      Split_Point * work = m_work.exchange(m_sg->root_sp()); // to make it non-null
+      if (work == nullptr) break;
+
+      move_loop(work);
+      work->leave();
+   }
+
+   assert(wait_sp->free());
+   assert(m_work == m_sg->root_sp());
+}
+
+void Search_Remote::give_work(Split_Point * sp) {
+
+   if (idle() && sp->local().ply == Ply_Root && cluster::is_alive(m_worker)) {
+
+      sp->enter();
+
+      assert(m_work.load() == nullptr);
+      m_work = sp;
+   }
+}
+
+bool Search_Remote::idle() const {
+   return m_work.load() == nullptr;
+}
+
+void Search_Remote::move_loop(Split_Point * sp) {
+
+   Local local = sp->local(); // local copy
+
+   while (true) {
+
+      Move mv = sp->get_move(local, m_smp); // also updates "local"
+      if (mv == move::None) break;
+
+      if (mv != local.skip_move) {
+
+         Score sc;
+         Line pv;
+         if (!search_move(mv, local, sp, sc, pv)) { // stopped or worker lost
+            if (!stop(sp)) sp->retry(mv); // let the local threads search it
+            break;
+         }
+
+         sp->update(mv, sc, pv, m_smp);
+      }
+   }
+}
+
+bool Search_Remote::search_move(Move mv, const Local & local, Split_Point * sp, Score & sc, Line & pv) {
+
+   assert(local.ply == Ply_Root);
+
+   Pos pos = local.node().succ(mv);
+
+   int id = cluster::request(m_worker, pos, local.depth - Depth(1));
+
+   while (true) {
+
+      m_sg->poll(); // local threads may all be waiting for the workers
+
+      if (stop(sp)) {
+         cluster::cancel(m_worker);
+         return false;
+      }
+
+      if (!cluster::is_alive(m_worker)) return false;
+
+      Score child_score;
+      std::string child_pv;
+      int64 nodes;
+
+      if (cluster::result(m_worker, id, child_score, child_pv, nodes)) {
+
+         m_node += nodes;
+
+         sc = -score::from_tt(child_score, Ply(1)); // worker scores are relative to the child
+
+         pv.clear();
+
+         std::stringstream ss(child_pv);
+         std::string arg;
+
+         while (ss >> arg && pv.size() < Ply_Size - 1) {
+
+            try {
+               Move child_mv = move::from_hub(arg, pos);
+               if (!move::is_legal(child_mv, pos)) break;
+               pv.add(child_mv);
+               pos = pos.succ(child_mv);
+            } catch (const Bad_Input &) {
+               break;
+            }
+         }
+
+         return true;
+      }
+   }
+}
+
+bool Search_Remote::stop(Split_Point * sp) {
+
+   for (Split_Point * s = sp; s != nullptr; s = s->parent()) {
+      if (s->stop()) return true;
+   }
+
+   return false;
+}
+
 void Split_Point::init_root() {
 
    m_parent = nullptr;
@@ -1528,6 +1940,7 @@ void Split_Point::init(Split_Point * parent, Search_Global & sg, const Local & l
    m_sg = &sg;
 
    m_local = local;
+   m_retry.clear();
 
    m_workers = 1; // master
    m_stop = false;
@@ -1547,15 +1960,19 @@ void Split_Point::leave() {
    m_workers -= 1;
 }
 
-Move Split_Point::get_move(Local & local) {
+Move Split_Point::get_move(Local & local, SMP_Stats & smp) {
 
    Move mv = move::None;
 
-   lock();
+   lock(smp);
 
-   if (m_local.score < m_local.beta && m_local.i < m_local.list.size()) {
+   if (m_local.score < m_local.beta) {
 
-      mv = m_local.list[m_local.i++];
+      if (!m_retry.empty()) {
+         mv = m_retry.remove();
+      } else if (m_local.i < m_local.list.size()) {
+         mv = m_local.list[m_local.i++];
+      }
 
       local.score = m_local.score;
       local.j = m_local.j;
@@ -1566,9 +1983,9 @@ Move Split_Point::get_move(Local & local) {
    return mv;
 }
 
-void Split_Point::update(Move mv, Score sc, const Line & pv) {
+void Split_Point::update(Move mv, Score sc, const Line & pv, SMP_Stats & smp) {
 
-   lock();
+   lock(smp);
 
    if (m_local.score < m_local.beta) { // ignore superfluous moves after a fail high
       local_update(m_local, mv, sc, pv, *m_sg);
@@ -1578,6 +1995,32 @@ void Split_Point::update(Move mv, Score sc, const Line & pv) {
    unlock();
 }
 
+void Split_Point::lock(SMP_Stats & smp) {
+
+   if (!try_lock()) { // contention
+      smp.lock_wait += 1;
+      lock();
+   }
+
+   smp.lock += 1;
+}
+
+void Split_Point::retry(Move mv) {
+
+   lock();
+   m_retry.add(mv);
+   unlock();
+}
+
+bool Split_Point::has_retry() const {
+
+   lock();
+   bool retry = !m_retry.empty();
+   unlock();
+
+   return retry;
+}
+
 static void local_update(Local & local, Move mv, Score sc, const Line & pv, Search_Global & sg) {
 
    assert(score::is_ok(sc));
@@ -1652,13 +2095,14 @@ std::string Line::to_string(const Pos & pos, int size_max) const {
 std::string Line::to_hub(const Pos & pos) const {
 
    std::string s;
+   s.reserve(size() * 8); // typical move length, longer captures grow it
 
    Pos new_pos = pos;
 
    for (Move mv : m_move) {
 
-      if (!s.empty()) s += " ";
-      s += move::to_hub(mv, new_pos);
+      if (!s.empty()) s += ' ';
+      move::add_hub(s, mv, new_pos);
 
       new_pos = new_pos.succ(mv);
    }
@@ -17,6 +17,8 @@
 class List;
 class Node;
 
+namespace hub { class Scanner; }
+
 // constants
 
 const Depth Depth_Max {Depth(99)};
@@ -76,7 +78,20 @@ public:
 
    void init ();
 
-   void set_time (int moves, double time, double inc);
+   void set_time  (int moves, double time, double inc);
+   void set_level (hub::Scanner & scan); // hub "level" pairs, on top of the current settings
+};
+
+struct SMP_Stats { // summed over threads
+
+   int64 split {0};
+   int64 join {0}; // split points entered by helpers
+   int64 lock {0}; // split-point lock acquisitions
+   int64 lock_wait {0}; // ... that found it taken
+   double wait {0.0}; // seconds, split owners waiting for their helpers
+   double spin {0.0}; // seconds, threads without work
+
+   void add (const SMP_Stats & stats);
 };
 
 class Search_Output {
@@ -93,6 +108,11 @@ public:
    int64 node {0};
    int64 leaf {0};
    int64 ply_sum {0};
+   int64 cut {0}; // beta cutoffs with a choice of moves
+   int64 cut_first {0}; // ... by the first move
+   SMP_Stats smp;
+
+   double first_time {-1.0}; // first best move ("info" in hub mode), for latency tracing
 
 private:
 
@@ -6,23 +6,6 @@
 #include <iostream>
 #include <string>
 
-#ifdef _WIN32
-
-#include <winsock2.h> // or just <winsock.h>?
-
-#else // assume Posix
-
-#include <sys/types.h>
-#include <sys/socket.h>
-#include <arpa/inet.h>
-#include <unistd.h>
-
-using SOCKET = int;
-const SOCKET INVALID_SOCKET {-1};
-void closesocket(int socket) { close(socket); }
-
-#endif
-
 #include "libmy.hpp"
 #include "socket.hpp"
 #include "var.hpp"
@@ -47,7 +30,7 @@ static bool has_input ();
 
 // functions
 
-void init() {
+void startup() {
 
 #ifdef _WIN32
 
@@ -59,30 +42,70 @@ void init() {
    }
 
 #endif
+}
 
-   struct sockaddr_in sa;
+SOCKET listen(int port, int backlog) {
 
-   if (var::DXP_Server) {
+   SOCKET listen_socket = socket(PF_INET, SOCK_STREAM, IPPROTO_TCP);
+   if (listen_socket == INVALID_SOCKET) {
+      std::perror("socket");
+      std::exit(EXIT_FAILURE);
+   }
 
-      SOCKET listen_socket = socket(PF_INET, SOCK_STREAM, IPPROTO_TCP);
-      if (listen_socket == INVALID_SOCKET) {
-         std::perror("socket");
-         std::exit(EXIT_FAILURE);
-      }
+   int yes = 1;
+   setsockopt(listen_socket, SOL_SOCKET, SO_REUSEADDR, (const char *) &yes, sizeof(yes));
 
-      sa.sin_family = AF_INET;
-      sa.sin_addr.s_addr = htonl(INADDR_ANY);
-      sa.sin_port = htons(var::DXP_Port);
+   struct sockaddr_in sa {};
+   sa.sin_family = AF_INET;
+   sa.sin_addr.s_addr = htonl(INADDR_ANY);
+   sa.sin_port = htons(port);
 
-      if (bind(listen_socket, (struct sockaddr *) &sa, sizeof(sa)) < 0) {
-         std::perror("bind");
-         std::exit(EXIT_FAILURE);
-      }
+   if (bind(listen_socket, (struct sockaddr *) &sa, sizeof(sa)) < 0) {
+      std::perror("bind");
+      std::exit(EXIT_FAILURE);
+   }
 
-      if (listen(listen_socket, 1) < 0) {
-         std::perror("listen");
-         std::exit(EXIT_FAILURE);
-      }
+   if (::listen(listen_socket, backlog) < 0) {
+      std::perror("listen");
+      std::exit(EXIT_FAILURE);
+   }
+
+   return listen_socket;
+}
+
+SOCKET open(const std::string & host, int port) {
+
+   SOCKET s = socket(PF_INET, SOCK_STREAM, IPPROTO_TCP);
+   if (s == INVALID_SOCKET) return INVALID_SOCKET;
+
+   struct sockaddr_in sa {};
+   sa.sin_family = AF_INET;
+   sa.sin_addr.s_addr = inet_addr(host.c_str());
+   sa.sin_port = htons(port);
+
+   if (connect(s, (struct sockaddr *) &sa, sizeof(sa)) < 0) {
+      close(s);
+      return INVALID_SOCKET;
+   }
+
+   return s;
+}
+
+void close(SOCKET socket) {
+#ifdef _WIN32
+   closesocket(socket);
+#else
+   ::close(socket);
+#endif
+}
+
+void init() {
+
+   startup();
+
+   if (var::DXP_Server) {
+
+      SOCKET listen_socket = listen(var::DXP_Port, 1);
 
       std::cout << "waiting for a connection" << std::endl;
 
@@ -92,21 +115,13 @@ void init() {
          std::exit(EXIT_FAILURE);
       }
 
-      closesocket(listen_socket);
+      close(listen_socket);
 
    } else { // client
 
-      G_Socket = socket(PF_INET, SOCK_STREAM, IPPROTO_TCP);
-      if (G_Socket == INVALID_SOCKET) {
-         std::perror("socket");
-         std::exit(EXIT_FAILURE);
-      }
-
-      sa.sin_family = AF_INET;
-      sa.sin_addr.s_addr = inet_addr(var::DXP_Host.c_str());
-      sa.sin_port = htons(var::DXP_Port);
+      G_Socket = open(var::DXP_Host, var::DXP_Port);
 
-      if (connect(G_Socket, (struct sockaddr *) &sa, sizeof(sa)) < 0) {
+      if (G_Socket == INVALID_SOCKET) {
          std::perror("connect");
          std::exit(EXIT_FAILURE);
       }
@@ -6,12 +6,33 @@
 
 #include <string>
 
+#ifdef _WIN32
+
+#include <winsock2.h> // or just <winsock.h>?
+
+#else // assume Posix
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+using SOCKET = int;
+const SOCKET INVALID_SOCKET {-1};
+
+#endif
+
 #include "libmy.hpp"
 
 namespace socket_ { // HACK: "socket" creates a conflict on macOS
 
 // functions
 
+void   startup ();
+SOCKET listen  (int port, int backlog); // exits on error
+SOCKET open    (const std::string & host, int port); // INVALID_SOCKET on error
+void   close   (SOCKET socket);
+
 void init ();
 
 std::string read  ();
@@ -1,13 +1,25 @@
 
 // includes
 
+#include <algorithm>
 #include <array>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
 
 #include "common.hpp"
+#include "embed.hpp"
+#include "gen.hpp"
 #include "libmy.hpp"
 #include "list.hpp"
+#include "logger.hpp"
 #include "move.hpp"
+#include "pos.hpp"
 #include "sort.hpp"
+#include "var.hpp"
 
 // constants
 
@@ -16,12 +28,67 @@ const int Prob_One   {1 << Prob_Bit};
 const int Prob_Half  {1 << (Prob_Bit - 1)};
 const int Prob_Shift {5}; // smaller => more adaptive
 
+// quiet-move model: one weight per binary feature, from the mover's point of view
+
+const int Feat_From    {0};
+const int Feat_To      {Feat_From    + Piece_Size * Dense_Size};
+const int Feat_Pattern {Feat_To      + Piece_Size * Dense_Size}; // 4 neighbours of "to" x {empty, own, opp, edge}
+const int Feat_Gives   {Feat_Pattern + Piece_Size * 256}; // opponent can capture after the move
+const int Feat_Threat  {Feat_Gives   + Piece_Size * 2}; // mover could capture again
+const int Feat_Answer  {Feat_Threat  + Piece_Size * 2}; // no threat, threat answered, threat ignored
+const int Feat_Size    {Feat_Answer  + Piece_Size * 3};
+
+const int Feat_Count {6}; // active features per move
+
+const int Weight_Bit   {10}; // fixed point in the model file
+const int Weight_Scale {Prob_One / 8}; // history units per logit unit
+
+// types
+
+struct Sample {
+   Pos pos;
+   Move move;
+};
+
 // variables
 
 static std::array<int, Move_Index_Size> G_Hist;
 
+static std::vector<int16> G_Weight; // empty => no model
+
+static bool G_Sample_On {false};
+static std::vector<Sample> G_Sample;
+
+// prototypes
+
+static void features (int feat[], Move mv, const Pos & pos, bool threat);
+
+static int model_score (Move mv, const Pos & pos, bool threat);
+
 // functions
 
+void sort_init() {
+
+   G_Weight.clear();
+
+   std::string file_name = std::string("data/sort") + var::variant_name();
+   embed::In_File file(file_name);
+   if (!file) return; // optional, see sort_train()
+
+   logger::put(logger::Level::Info, "init sort");
+
+   G_Weight.resize(Feat_Size);
+
+   for (int i = 0; i < Feat_Size; i++) {
+      G_Weight[i] = int16(ml::get_bytes(file, 2)); // HACK: extend sign
+   }
+
+   if (!file) {
+      std::cerr << "corrupted file \"" << file_name << "\"" << std::endl;
+      std::exit(EXIT_FAILURE);
+   }
+}
+
 void sort_clear() {
    G_Hist.fill(Prob_Half);
 }
@@ -40,12 +107,25 @@ void sort_moves(List & list, const Pos & pos, Move_Index tt_move) {
 
    if (list.size() <= 1) return;
 
+   bool model = !G_Weight.empty() && !move::is_capture(list[0], pos); // all moves are quiet or none
+   bool threat = model && pos::is_threat(pos);
+
    for (int i = 0; i < list.size(); i++) {
 
       Move mv = list[i];
       Move_Index index = move::index(mv, pos);
 
-      int sc = (index == tt_move) ? Prob_One - 1 : G_Hist[index];
+      int sc;
+
+      if (index == tt_move) {
+         sc = Prob_One - 1;
+      } else if (model) {
+         sc = G_Hist[index] + ((model_score(mv, pos, threat) * Weight_Scale) >> Weight_Bit);
+         sc = std::max(0, std::min(sc, Prob_One - 2));
+      } else {
+         sc = G_Hist[index];
+      }
+
       assert(sc >= 0 && sc < Prob_One);
 
       list.set_score(i, sc);
@@ -54,3 +134,195 @@ void sort_moves(List & list, const Pos & pos, Move_Index tt_move) {
    list.sort();
 }
 
+void sort_sample_start() {
+   G_Sample_On = true;
+   G_Sample.clear();
+}
+
+void sort_sample(Move mv, const Pos & pos) { // not thread safe
+   if (G_Sample_On && !move::is_capture(mv, pos)) G_Sample.push_back({pos, mv});
+}
+
+void sort_train(const std::string & file_name, int epochs) {
+
+   G_Sample_On = false;
+
+   std::cout << G_Sample.size() << " samples" << std::endl;
+
+   std::mt19937_64 rand(ml::rand_int_64());
+   std::shuffle(G_Sample.begin(), G_Sample.end(), rand); // consecutive samples come from the same search
+
+   // softmax regression over the quiet moves of each sample
+
+   std::vector<double> weight(Feat_Size, 0.0);
+
+   std::vector<int> feat;
+   std::vector<double> prob;
+
+   for (int epoch = 0; epoch < epochs; epoch++) {
+
+      double lr = 0.05 / (1.0 + epoch);
+      double loss = 0.0;
+      int64 hit = 0;
+
+      for (const Sample & sample : G_Sample) {
+
+         const Pos & pos = sample.pos;
+
+         List list;
+         gen_moves(list, pos);
+         if (list.size() <= 1) continue;
+
+         bool threat = pos::is_threat(pos);
+
+         int size = list.size();
+         feat.resize(size * Feat_Count);
+         prob.resize(size);
+
+         int best = -1;
+         double max = -1E9;
+
+         for (int i = 0; i < size; i++) {
+
+            features(&feat[i * Feat_Count], list[i], pos, threat);
+
+            double sum = 0.0;
+            for (int j = 0; j < Feat_Count; j++) sum += weight[feat[i * Feat_Count + j]];
+
+            prob[i] = sum;
+            if (list[i] == sample.move) best = i;
+            max = std::max(max, sum);
+         }
+
+         assert(best >= 0);
+
+         bool top = true;
+
+         for (int i = 0; i < size; i++) {
+            if (i != best && prob[i] >= prob[best]) top = false;
+         }
+
+         double total = 0.0;
+
+         for (int i = 0; i < size; i++) {
+            prob[i] = std::exp(prob[i] - max);
+            total += prob[i];
+         }
+
+         if (top) hit += 1;
+         loss -= std::log(prob[best] / total);
+
+         for (int i = 0; i < size; i++) {
+
+            double grad = prob[i] / total - ((i == best) ? 1.0 : 0.0);
+
+            for (int j = 0; j < Feat_Count; j++) {
+               weight[feat[i * Feat_Count + j]] -= lr * grad;
+            }
+         }
+
+         for (int j = 0; j < Feat_Count; j++) { // L2 on the active weights only, for speed
+            double & w = weight[feat[best * Feat_Count + j]];
+            w -= lr * 1E-4 * w;
+         }
+      }
+
+      double n = double(std::max(G_Sample.size(), size_t(1)));
+      std::cout << "epoch " << (epoch + 1) << "/" << epochs << ": loss " << ml::ftos(loss / n, 4) << ", top-1 " << ml::ftos(double(hit) / n * 100.0, 1) << "%" << std::endl;
+   }
+
+   // save
+
+   std::ofstream file(file_name, std::ios::binary);
+
+   if (!file) {
+      std::cerr << "unable to open file \"" << file_name << "\"" << std::endl;
+      std::exit(EXIT_FAILURE);
+   }
+
+   for (int i = 0; i < Feat_Size; i++) {
+      int w = int(std::lround(weight[i] * double(1 << Weight_Bit)));
+      w = std::max(-32767, std::min(w, +32767));
+      ml::put_bytes(file, uint16(int16(w)), 2);
+   }
+
+   G_Sample.clear();
+}
+
+void sort_model(bool on) { // for benchmarking
+   if (on) {
+      sort_init();
+   } else {
+      G_Weight.clear();
+   }
+}
+
+static int model_score(Move mv, const Pos & pos, bool threat) {
+
+   int feat[Feat_Count];
+   features(feat, mv, pos, threat);
+
+   int sum = 0;
+
+   for (int i = 0; i < Feat_Count; i++) {
+      sum += G_Weight[feat[i]];
+   }
+
+   return sum;
+}
+
+static void features(int feat[], Move mv, const Pos & pos, bool threat) {
+
+   Side atk = pos.turn();
+   Side def = side_opp(atk);
+
+   Square from = move::from(mv, pos);
+   Square to   = move::to(mv, pos);
+
+   int pc = pos.is_piece(from, King) ? King : Man;
+
+   // squares from the mover's point of view
+
+   Square from_n = (atk == White) ? from : square_opp(from);
+   Square to_n   = (atk == White) ? to   : square_opp(to);
+
+   feat[0] = Feat_From + pc * Dense_Size + square_dense(from_n);
+   feat[1] = Feat_To   + pc * Dense_Size + square_dense(to_n);
+
+   // local pattern around the destination, "from" is empty after the move
+
+   int pattern = 0;
+
+   for (int dir = 0; dir < 4; dir++) {
+
+      int d = (atk == White) ? dir : 3 - dir; // mirror for Black
+      int sq = to + dir_inc(d);
+
+      int trit;
+
+      if (!square_is_ok(sq)) {
+         trit = 3;
+      } else if (sq == from || pos.is_empty(square_make(sq))) {
+         trit = 0;
+      } else if (pos.is_side(square_make(sq), atk)) {
+         trit = 1;
+      } else {
+         trit = 2;
+      }
+
+      pattern = pattern * 4 + trit;
+   }
+
+   feat[2] = Feat_Pattern + pc * 256 + pattern;
+
+   // tactics
+
+   Pos new_pos = pos.succ(mv);
+
+   bool gives = can_capture(new_pos, def);
+   bool makes = can_capture(new_pos, atk);
+
+   feat[3] = Feat_Gives  + pc * 2 + (gives ? 1 : 0);
+   feat[4] = Feat_Threat + pc * 2 + (makes ? 1 : 0);
+   feat[5] = Feat_Answer + pc * 3 + (!threat ? 0 : !gives ? 1 : 2);
+}
@@ -4,6 +4,8 @@
 
 // includes
 
+#include <string>
+
 #include "common.hpp"
 #include "libmy.hpp"
 
@@ -12,6 +14,7 @@ class Pos;
 
 // functions
 
+void sort_init  ();
 void sort_clear ();
 
 void good_move (Move mv, const Pos & pos);
@@ -19,5 +22,11 @@ void bad_move  (Move mv, const Pos & pos);
 
 void sort_moves (List & list, const Pos & pos, Move_Index tt_move);
 
+void sort_sample_start ();
+void sort_sample       (Move mv, const Pos & pos);
+void sort_train        (const std::string & file_name, int epochs);
+
+void sort_model (bool on);
+
 #endif // !defined SORT_HPP
 
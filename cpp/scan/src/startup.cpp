@@ -0,0 +1,117 @@
+
+// includes
+
+#include <exception>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bb_base.hpp"
+#include "bit.hpp"
+#include "book.hpp"
+#include "eval.hpp"
+#include "libmy.hpp"
+#include "sort.hpp"
+#include "startup.hpp"
+#include "tt.hpp"
+#include "util.hpp"
+#include "var.hpp"
+
+namespace startup {
+
+// types
+
+struct Job {
+   std::string name;
+   std::function<void()> fn;
+};
+
+// prototypes
+
+static void run (Phase & phase, const Job & job);
+
+// functions
+
+Report init() {
+
+   Timer timer;
+   timer.start();
+
+   bit::init(); // depends on the variant, used by all phases
+
+   // the phases share nothing but read-only tables
+
+   std::vector<Job> jobs;
+
+   if (var::Book) jobs.push_back({"book", book::init});
+   if (var::BB)   jobs.push_back({"bb",   bb::init});
+
+   jobs.push_back({"eval", eval_init});
+   jobs.push_back({"sort", sort_init});
+   jobs.push_back({"tt",   [] { G_TT.set_size(var::TT_Size); }}); // clears in parallel itself
+
+   Report report;
+   report.phase.resize(jobs.size());
+
+   std::vector<std::thread> pool;
+
+   for (int i = 1; i < int(jobs.size()); i++) {
+      pool.emplace_back(run, std::ref(report.phase[i]), std::cref(jobs[i]));
+   }
+
+   run(report.phase[0], jobs[0]);
+
+   for (std::thread & thread : pool) { // readiness barrier
+      thread.join();
+   }
+
+   timer.stop();
+   report.time = timer.elapsed();
+
+   return report;
+}
+
+static void run(Phase & phase, const Job & job) {
+
+   Timer timer;
+   timer.start();
+
+   try {
+      job.fn();
+   } catch (...) {
+      phase.error = std::current_exception();
+   }
+
+   timer.stop();
+
+   phase.name = job.name;
+   phase.time = timer.elapsed();
+}
+
+bool Report::ok(const std::string & name) const {
+
+   for (const Phase & ph : phase) {
+      if (ph.name == name) return ph.error == nullptr;
+   }
+
+   return true;
+}
+
+std::string Report::to_string() const {
+
+   std::string s = "init";
+
+   for (const Phase & ph : phase) {
+      s += " " + ph.name + " " + ml::ftos(ph.time, 3) + "s";
+      if (ph.error != nullptr) s += " (failed)";
+      s += ",";
+   }
+
+   s += " total " + ml::ftos(time, 3) + "s";
+
+   return s;
+}
+
+} // namespace startup
+
@@ -0,0 +1,39 @@
+
+#ifndef STARTUP_HPP
+#define STARTUP_HPP
+
+// includes
+
+#include <exception>
+#include <string>
+#include <vector>
+
+#include "libmy.hpp"
+
+namespace startup {
+
+// types
+
+struct Phase {
+   std::string name; // "book", "bb", "eval", "sort" or "tt"
+   double time {0.0};
+   std::exception_ptr error; // null if the phase succeeded
+};
+
+struct Report {
+
+   std::vector<Phase> phase;
+   double time {0.0}; // wall clock, including the barrier
+
+   bool ok (const std::string & name) const; // true for phases that did not run
+   std::string to_string () const;
+};
+
+// functions
+
+Report init (); // loads everything concurrently, returns once all phases are done
+
+} // namespace startup
+
+#endif // !defined STARTUP_HPP
+
@@ -67,6 +67,14 @@ bool get_line(std::string & line) {
    return G_Input.get_line(line);
 }
 
+void put_line(const std::string & line) {
+   G_Input.put_line(line);
+}
+
+void put_eof() {
+   G_Input.put_eof();
+}
+
 bool Input::peek_line(std::string & line) {
 
    lock();
@@ -23,8 +23,9 @@ protected: // HACK for Waitable::wait()
 
 public:
 
-   void lock   () const { m_mutex.lock(); }
-   void unlock () const { m_mutex.unlock(); }
+   void lock     () const { m_mutex.lock(); }
+   void unlock   () const { m_mutex.unlock(); }
+   bool try_lock () const { return m_mutex.try_lock(); }
 };
 
 class Waitable : public Lockable {
@@ -47,5 +48,8 @@ bool has_input ();
 bool peek_line (std::string & line);
 bool get_line  (std::string & line);
 
+void put_line (const std::string & line); // for non-stdin sources
+void put_eof  ();
+
 #endif // !defined THREAD_HPP
 
@@ -0,0 +1,439 @@
+
+// includes
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "common.hpp"
+#include "hub.hpp"
+#include "libmy.hpp"
+#include "move.hpp"
+#include "pos.hpp"
+#include "search.hpp"
+#include "timeman.hpp"
+#include "util.hpp"
+#include "var.hpp"
+
+namespace timeman {
+
+// types
+
+struct Iter {
+   Depth depth;
+   double time;
+   std::string move;
+   double share;
+   int changes;
+};
+
+struct Record { // one search from a trace file
+
+   int moves;
+   double time;
+   double inc;
+   double phase;
+   bool ponder;
+   Depth depth_min;
+
+   std::vector<Iter> iter;
+
+   double end_time;
+   std::string end_move;
+};
+
+struct Result {
+   double time;
+   std::string move;
+   bool beyond; // the policy would have searched past the end of the trace
+};
+
+// prototypes
+
+static std::vector<Record> load (const std::string & file_name);
+
+static Result replay (const Record & rec, const Policy & policy);
+static void   report (const std::string & name, const std::vector<Record> & recs, const std::vector<Result> & res, const std::vector<Result> * base);
+
+static double lerp     (double mg, double eg, double phase);
+static double time_lag (double time);
+
+// functions
+
+bool Policy::set(const std::string & name, double value) {
+
+   if (false) {
+   } else if (name == "moves-mg") {
+      moves_mg = value;
+   } else if (name == "moves-eg") {
+      moves_eg = value;
+   } else if (name == "alloc") {
+      alloc = value;
+   } else if (name == "ponder") {
+      ponder = value;
+   } else if (name == "extend") {
+      extend = value;
+   } else if (name == "stable") {
+      stable = value;
+   } else if (name == "stable-min") {
+      stable_min = value;
+   } else if (name == "change") {
+      change = value;
+   } else if (name == "change-max") {
+      change_max = value;
+   } else if (name == "exit-mg") {
+      exit_mg = value;
+   } else if (name == "exit-eg") {
+      exit_eg = value;
+   } else if (name == "easy-share") {
+      easy_share = value;
+   } else if (name == "easy-exit") {
+      easy_exit = value;
+   } else {
+      return false;
+   }
+
+   return true;
+}
+
+double Policy::factor_stable(double factor) const {
+   return std::max(factor * stable, stable_min);
+}
+
+double Policy::factor_change(double factor) const {
+   return std::min(std::max(factor, 1.0) * change, change_max);
+}
+
+double Policy::exit(double phase, double share) const {
+   double exit = lerp(exit_mg, exit_eg, phase);
+   if (share > easy_share) exit *= easy_exit;
+   return exit;
+}
+
+void Time::init(const Search_Input & si, const Pos & pos, const Policy & policy) {
+
+   if (si.smart) {
+      init(si.moves, si.time, si.inc, pos::phase(pos), var::Ponder, policy);
+   } else {
+      init(si.time);
+   }
+}
+
+void Time::init(double time) {
+   m_time_0 = time;
+   m_time_1 = time;
+}
+
+void Time::init(int moves, double time, double inc, double phase, bool ponder, const Policy & policy) {
+
+   double moves_left = lerp(policy.moves_mg, policy.moves_eg, phase);
+   if (moves != 0) moves_left = std::min(moves_left, double(moves));
+
+   double factor = policy.alloc;
+   if (ponder) factor *= policy.ponder;
+
+   double total = std::max(time + inc * moves_left, 0.0);
+   double alloc = total / moves_left * factor;
+
+   if (moves > 1) { // save some time for the following moves
+      double total_safe = std::max((time / double(moves - 1) + inc - (time / double(moves) + inc) * 0.5) * double(moves - 1), 0.0);
+      total = std::min(total, total_safe);
+   }
+
+   double max = time_lag(std::min(total, time + inc) * 0.95);
+
+   m_time_0 = std::min(time_lag(alloc), max);
+   m_time_1 = std::min(time_lag(alloc * policy.extend), max);
+
+   assert(0.0 <= m_time_0 && m_time_0 <= m_time_1);
+}
+
+void Trace::start(const Search_Input & si, const Pos & pos, Depth depth_min) {
+
+   m_on = si.smart && !var::Time_Trace.empty();
+   if (!m_on) return;
+
+   m_pos = pos;
+
+   m_text = "search";
+   hub::add_pair(m_text, "moves", si.moves);
+   hub::add_pair(m_text, "time", ml::ftos(si.time, 3));
+   hub::add_pair(m_text, "inc", ml::ftos(si.inc, 3));
+   hub::add_pair(m_text, "phase", ml::ftos(pos::phase(pos), 4));
+   hub::add_pair(m_text, "ponder", var::Ponder ? "true" : "false");
+   hub::add_pair(m_text, "depth-min", depth_min);
+   m_text += "\n";
+}
+
+void Trace::iter(Depth depth, double time, Move mv, Score sc, double share, int changes) {
+
+   if (!m_on) return;
+
+   std::string line = "iter";
+   hub::add_pair(line, "depth", depth);
+   hub::add_pair(line, "time", ml::ftos(time, 3));
+   hub::add_pair(line, "move", (mv == move::None) ? "none" : move::to_hub(mv, m_pos));
+   hub::add_pair(line, "score", ml::ftos(double(sc) / 100.0, 2));
+   hub::add_pair(line, "share", ml::ftos(share, 3));
+   hub::add_pair(line, "changes", changes);
+   m_text += line + "\n";
+}
+
+void Trace::end(double time, Move mv) {
+
+   if (!m_on) return;
+
+   std::string line = "end";
+   hub::add_pair(line, "time", ml::ftos(time, 3));
+   hub::add_pair(line, "move", (mv == move::None) ? "none" : move::to_hub(mv, m_pos));
+   m_text += line + "\n";
+
+   std::ofstream file(var::Time_Trace, std::ios::app);
+
+   if (!file) {
+      std::cerr << "unable to open file \"" << var::Time_Trace << "\"" << std::endl;
+      std::exit(EXIT_FAILURE);
+   }
+
+   file << m_text; // one block per search, never interleaved with another
+   m_on = false;
+}
+
+void simulate(const std::string & file_name, const Policy & policy) {
+
+   std::vector<Record> recs = load(file_name);
+
+   if (recs.empty()) {
+      std::cerr << "no searches in \"" << file_name << "\"" << std::endl;
+      std::exit(EXIT_FAILURE);
+   }
+
+   std::vector<Result> engine;
+   std::vector<Result> custom;
+
+   for (const Record & rec : recs) {
+      engine.push_back(replay(rec, Policy()));
+      custom.push_back(replay(rec, policy));
+   }
+
+   double time = 0.0;
+   for (const Record & rec : recs) time += rec.end_time;
+
+   std::cout << recs.size() << " searches, " << ml::ftos(time, 1) << " s recorded" << std::endl;
+   std::cout << std::endl;
+
+   report("engine", recs, engine, nullptr);
+   report("policy", recs, custom, &engine);
+}
+
+static std::vector<Record> load(const std::string & file_name) {
+
+   std::ifstream file(file_name);
+
+   if (!file) {
+      std::cerr << "unable to open file \"" << file_name << "\"" << std::endl;
+      std::exit(EXIT_FAILURE);
+   }
+
+   std::vector<Record> recs;
+   bool open = false; // inside a search block
+
+   std::string line;
+   int line_no = 0;
+
+   while (std::getline(file, line)) {
+
+      line_no += 1;
+
+      try {
+
+         hub::Scanner scan(line);
+         if (scan.eos()) continue;
+
+         std::string command = scan.get_command();
+
+         if (false) {
+
+         } else if (command == "search") {
+
+            Record rec {0, 0.0, 0.0, 0.0, false, Depth(0), {}, 0.0, ""};
+
+            while (!scan.eos()) {
+
+               auto p = scan.get_pair();
+
+               if (false) {
+               } else if (p.name == "moves") {
+                  rec.moves = std::stoi(p.value);
+               } else if (p.name == "time") {
+                  rec.time = std::stod(p.value);
+               } else if (p.name == "inc") {
+                  rec.inc = std::stod(p.value);
+               } else if (p.name == "phase") {
+                  rec.phase = std::stod(p.value);
+               } else if (p.name == "ponder") {
+                  rec.ponder = p.value == "true";
+               } else if (p.name == "depth-min") {
+                  rec.depth_min = Depth(std::stoi(p.value));
+               }
+            }
+
+            if (open) recs.pop_back(); // truncated block, e.g. engine killed
+            recs.push_back(rec);
+            open = true;
+
+         } else if (command == "iter" && open) {
+
+            Iter it {Depth(0), 0.0, "", 0.0, 0};
+
+            while (!scan.eos()) {
+
+               auto p = scan.get_pair();
+
+               if (false) {
+               } else if (p.name == "depth") {
+                  it.depth = Depth(std::stoi(p.value));
+               } else if (p.name == "time") {
+                  it.time = std::stod(p.value);
+               } else if (p.name == "move") {
+                  it.move = p.value;
+               } else if (p.name == "share") {
+                  it.share = std::stod(p.value);
+               } else if (p.name == "changes") {
+                  it.changes = std::stoi(p.value);
+               }
+            }
+
+            recs.back().iter.push_back(it);
+
+         } else if (command == "end" && open) {
+
+            Record & rec = recs.back();
+
+            while (!scan.eos()) {
+
+               auto p = scan.get_pair();
+
+               if (false) {
+               } else if (p.name == "time") {
+                  rec.end_time = std::stod(p.value);
+               } else if (p.name == "move") {
+                  rec.end_move = p.value;
+               }
+            }
+
+            open = false;
+
+         } else {
+
+            throw Bad_Input();
+         }
+
+      } catch (const std::exception &) { // Bad_Input or std::sto*()
+
+         std::cerr << "invalid line " << line_no << " in \"" << file_name << "\"" << std::endl;
+         std::exit(EXIT_FAILURE);
+      }
+   }
+
+   if (open) recs.pop_back();
+
+   return recs;
+}
+
+static Result replay(const Record & rec, const Policy & policy) {
+
+   // mirrors search() and Search_Global at iteration granularity
+
+   Time time;
+   time.init(rec.moves, rec.time, rec.inc, rec.phase, rec.ponder, policy);
+
+   double factor = 1.0;
+   std::string last_move = "none";
+
+   for (const Iter & it : rec.iter) {
+
+      // hard limit inside this iteration => keep the previous best move (a mid-iteration change is not in the trace)
+
+      if (it.depth > rec.depth_min && it.time > time.time_1()) {
+         return { time.time_1(), last_move, false };
+      }
+
+      for (int i = 0; i < it.changes; i++) {
+         factor = policy.factor_change(factor);
+      }
+
+      if (it.depth > 1 && it.move == last_move) {
+         factor = policy.factor_stable(factor);
+      }
+
+      last_move = it.move;
+
+      if (it.depth >= rec.depth_min && it.time >= time.time_0() * factor * policy.exit(rec.phase, it.share)) {
+         return { it.time, it.move, false };
+      }
+   }
+
+   // the recorded search stopped first (its own limit, depth, or input)
+
+   if (!rec.iter.empty() && rec.iter.back().depth + 1 > rec.depth_min && time.time_1() < rec.end_time) {
+      return { time.time_1(), last_move, false };
+   }
+
+   return { rec.end_time, rec.end_move, true };
+}
+
+static void report(const std::string & name, const std::vector<Record> & recs, const std::vector<Result> & res, const std::vector<Result> * base) {
+
+   assert(res.size() == recs.size());
+
+   int size = int(recs.size());
+
+   double time_rec = 0.0;
+   double time = 0.0;
+   double time_base = 0.0;
+
+   int changed = 0;
+   int differ = 0;
+   int beyond = 0;
+
+   for (int i = 0; i < size; i++) {
+
+      time_rec += recs[i].end_time;
+      time += res[i].time;
+
+      if (res[i].move != recs[i].end_move) changed += 1;
+      if (res[i].beyond) beyond += 1;
+
+      if (base != nullptr) {
+         time_base += (*base)[i].time;
+         if (res[i].move != (*base)[i].move) differ += 1;
+      }
+   }
+
+   auto pct = [size](int n) { return ml::ftos(double(n) / double(size) * 100.0, 1) + "%"; };
+   auto delta = [](double t, double ref) { return ((t >= ref) ? "+" : "") + ml::ftos((t - ref) / std::max(ref, 1E-6) * 100.0, 1) + "%"; };
+
+   std::cout << name << ": " << ml::ftos(time, 1) << " s (" << delta(time, time_rec) << " vs recorded)";
+   std::cout << ", final move changed " << pct(changed);
+   std::cout << ", past trace " << pct(beyond) << std::endl;
+
+   if (base != nullptr) {
+      std::cout << "   vs engine: time " << delta(time, time_base) << ", final move changed " << pct(differ) << std::endl;
+   }
+}
+
+static double lerp(double mg, double eg, double phase) {
+   assert(phase >= 0.0 && phase <= 1.0);
+   return mg + (eg - mg) * phase;
+}
+
+static double time_lag(double time) {
+   return std::max(time - 0.1, 0.0);
+}
+
+} // namespace timeman
+
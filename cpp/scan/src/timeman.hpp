@@ -0,0 +1,84 @@
+
+#ifndef TIMEMAN_HPP
+#define TIMEMAN_HPP
+
+// includes
+
+#include <string>
+
+#include "common.hpp"
+#include "libmy.hpp"
+#include "pos.hpp"
+
+class Search_Input;
+
+namespace timeman {
+
+// types
+
+struct Policy { // defaults are the engine's
+
+   double moves_mg {30.0}; // moves left, opening
+   double moves_eg {10.0}; // moves left, endgame
+   double alloc {1.3}; // target = fair share * alloc
+   double ponder {1.2}; // extra alloc when pondering
+   double extend {4.0}; // hard limit = fair share * alloc * extend
+
+   double stable {0.9}; // factor decay when the best move survives an iteration
+   double stable_min {0.6};
+   double change {1.2}; // factor boost when the best move changes
+   double change_max {2.0};
+
+   double exit_mg {0.4}; // no new iteration after target * factor * exit
+   double exit_eg {0.8};
+   double easy_share {1.0}; // best move's node share above which ... (1 = off)
+   double easy_exit {0.5}; // ... exit is scaled by this
+
+   bool set (const std::string & name, double value);
+
+   double factor_stable (double factor) const;
+   double factor_change (double factor) const;
+
+   double exit (double phase, double share) const;
+};
+
+class Time {
+
+private:
+
+   double m_time_0; // target
+   double m_time_1; // extended
+
+public:
+
+   void init (const Search_Input & si, const Pos & pos, const Policy & policy);
+   void init (double time);
+   void init (int moves, double time, double inc, double phase, bool ponder, const Policy & policy);
+
+   double time_0 () const { return m_time_0; }
+   double time_1 () const { return m_time_1; }
+};
+
+class Trace { // one timed search, appended to the "time-trace" file
+
+private:
+
+   bool m_on {false};
+   Pos m_pos;
+   std::string m_text;
+
+public:
+
+   void start (const Search_Input & si, const Pos & pos, Depth depth_min);
+   void iter  (Depth depth, double time, Move mv, Score sc, double share, int changes);
+   void end   (double time, Move mv);
+};
+
+// functions
+
+void simulate (const std::string & file_name, const Policy & policy);
+
+} // namespace timeman
+
+#endif // !defined TIMEMAN_HPP
+
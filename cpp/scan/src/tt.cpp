@@ -3,6 +3,8 @@
 
 #include <algorithm>
 #include <cmath>
+#include <thread>
+#include <vector>
 
 #include "common.hpp"
 #include "hash.hpp"
@@ -13,6 +15,10 @@
 // constants
 
 const int Cluster_Size {4};
+const int Gen_Size {256}; // generation 0 is only used by wipe()
+
+const int Clear_Size    {1 << 20}; // entries per clearing thread, at least
+const int Clear_Threads {8};
 
 // variables
 
@@ -22,25 +28,57 @@ TT G_TT;
 
 void TT::set_size(int size) {
 
+   if (size != m_size || m_table == nullptr) {
+      m_table.reset(); // free first
+      m_table.reset(new Entry[size]); // first touch in clear()
+   }
+
    m_size = size;
    m_mask = (size - 1) & -Cluster_Size;
 
-   m_table.resize(m_size);
-
-   clear();
+   wipe();
 }
 
 void TT::clear() {
 
+   m_gen += 1;
+   if (m_gen == Gen_Size) wipe(); // generations are reused, wipe older entries first
+
+   set_date(0);
+}
+
+void TT::wipe() {
+
    static_assert(sizeof(Entry) == 16, "");
 
    Entry entry {};
    entry.move = Move_Index_None;
    entry.score = score::None;
    entry.flag = int(Flag::None);
+   entry.gen = 0;
+
+   int threads = std::min(std::max(m_size / Clear_Size, 1), std::max(int(std::thread::hardware_concurrency()), 1));
+   threads = std::min(threads, Clear_Threads);
 
-   std::fill(m_table.begin(), m_table.end(), entry);
+   auto fill = [this, entry, threads](int i) {
+      Entry * begin = m_table.get() + int64(m_size) * i / threads;
+      Entry * end   = m_table.get() + int64(m_size) * (i + 1) / threads;
+      std::fill(begin, end, entry);
+   };
 
+   std::vector<std::thread> pool;
+
+   for (int i = 1; i < threads; i++) {
+      pool.emplace_back(fill, i);
+   }
+
+   fill(0);
+
+   for (std::thread & thread : pool) {
+      thread.join();
+   }
+
+   m_gen = 1;
    set_date(0);
 }
 
@@ -75,6 +113,7 @@ void TT::store(Key key, Move_Index move, Score score, Flag flag, Depth depth) {
    int    index = hash::index(key, m_mask);
    uint32 lock  = hash::lock(key);
 
+   Entry * empty = nullptr;
    Entry * be = nullptr;
    int bs = -256;
 
@@ -83,6 +122,11 @@ void TT::store(Key key, Move_Index move, Score score, Flag flag, Depth depth) {
       assert(index + i < m_size);
       Entry & entry = m_table[index + i];
 
+      if (entry.gen != m_gen) { // empty; keep looking for a hit further in the cluster
+         if (empty == nullptr) empty = &entry;
+         continue;
+      }
+
       if (entry.lock == lock) { // hash hit
 
          if (entry.depth <= depth) {
@@ -117,6 +161,8 @@ void TT::store(Key key, Move_Index move, Score score, Flag flag, Depth depth) {
 
    // "best" entry found
 
+   if (empty != nullptr) be = empty;
+
    assert(be != nullptr);
    Entry & entry = *be;
    // assert(entry.lock != lock); // triggers in SMP
@@ -124,6 +170,7 @@ void TT::store(Key key, Move_Index move, Score score, Flag flag, Depth depth) {
    // store
 
    entry.lock = lock;
+   entry.gen = m_gen;
    entry.date = m_date;
    entry.move = move;
    entry.score = score;
@@ -143,7 +190,7 @@ bool TT::probe(Key key, Move_Index & move, Score & score, Flag & flag, Depth & d
       assert(index + i < m_size);
       const Entry & entry = m_table[index + i];
 
-      if (entry.lock == lock) {
+      if (entry.lock == lock && entry.gen == m_gen) {
 
          // found
 
@@ -4,7 +4,7 @@
 
 // includes
 
-#include <vector>
+#include <memory>
 
 #include "common.hpp"
 #include "libmy.hpp"
@@ -32,13 +32,14 @@ private:
       uint8 depth;
       uint8 date;
       uint8 flag;
-      uint8 pad_1; // #
+      uint8 gen; // entries from other generations are empty
    };
 
-   std::vector<Entry> m_table;
+   std::unique_ptr<Entry[]> m_table; // not value-initialised, see wipe()
 
    int m_size {0};
    int m_mask {0};
+   int m_gen {0};
    int m_date {0};
    int m_age[Date_Size] {};
 
@@ -46,7 +47,7 @@ public:
 
    void set_size (int size);
 
-   void clear    ();
+   void clear    (); // O(1), new generation
    void inc_date ();
 
    void store (Key key, Move_Index move, Score score, Flag flag, Depth depth);
@@ -54,6 +55,7 @@ public:
 
 private:
 
+   void wipe     (); // in parallel for large tables
    void set_date (int date);
 };
 
@@ -0,0 +1,247 @@
+
+// includes
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "common.hpp"
+#include "game.hpp"
+#include "gen.hpp"
+#include "libmy.hpp"
+#include "list.hpp"
+#include "pos.hpp"
+#include "search.hpp"
+#include "tt.hpp"
+#include "tune.hpp"
+#include "var.hpp"
+
+namespace tune {
+
+// constants
+
+const int Opening_Ply {4}; // random moves before the engines take over
+const int Game_Ply_Max {200}; // adjudicated as a draw
+
+// types
+
+struct Param {
+   const char * name;
+   int value;
+   int min;
+   int max;
+};
+
+// variables
+
+#ifdef TUNE
+#define TUNE_DEFINE(name, value, min, max) int name {value};
+TUNE_PARAMS(TUNE_DEFINE)
+#endif
+
+#define TUNE_TABLE(name, value, min, max) { #name, value, min, max },
+static const Param G_Param[] { TUNE_PARAMS(TUNE_TABLE) };
+
+const int Size {sizeof(G_Param) / sizeof(G_Param[0])};
+
+// prototypes
+
+#ifdef TUNE
+static std::string setting   (const Param & param);
+static int *       param_var (int i);
+
+static void apply     (const std::vector<int> & values);
+static int  play_game (const std::vector<int> & white, const std::vector<int> & black, const std::vector<Move> & opening, int64 nodes);
+#endif
+
+// functions
+
+void init() {
+
+#ifdef TUNE
+   for (const Param & param : G_Param) {
+      var::set(setting(param), std::to_string(param.value));
+   }
+#endif
+}
+
+void update() {
+
+#ifdef TUNE
+   for (int i = 0; i < Size; i++) {
+      const Param & param = G_Param[i];
+      *param_var(i) = std::max(param.min, std::min(std::stoi(var::get(setting(param))), param.max));
+   }
+#endif
+}
+
+#ifdef TUNE
+
+static std::string setting(const Param & param) { // LMR_Depth -> lmr-depth
+
+   std::string name = param.name;
+
+   for (char & c : name) {
+      c = (c == '_') ? '-' : char(std::tolower(c));
+   }
+
+   return name;
+}
+
+static int * param_var(int i) {
+
+   static int * const Var[] {
+#define TUNE_POINTER(name, value, min, max) &name,
+      TUNE_PARAMS(TUNE_POINTER)
+#undef TUNE_POINTER
+   };
+
+   assert(i >= 0 && i < Size);
+   return Var[i];
+}
+
+void spsa(int iterations, int games, int64 nodes) {
+
+   std::mt19937_64 rand(ml::rand_int_64());
+
+   update();
+
+   std::vector<double> theta(Size);
+   std::vector<double> step(Size);
+
+   for (int i = 0; i < Size; i++) {
+      theta[i] = double(*param_var(i)); // starts from the INI values
+      step[i] = std::max(1.0, double(G_Param[i].max - G_Param[i].min) / 20.0);
+   }
+
+   std::cout << "SPSA: " << Size << " parameters, " << games << " games of " << nodes << " nodes per move per iteration" << std::endl;
+
+   for (int k = 1; k <= iterations; k++) {
+
+      double ck = 1.0 / std::pow(double(k), 0.101);
+      double ak = 1.0 / std::pow(double(k) + iterations * 0.1, 0.602);
+
+      // perturbation
+
+      std::vector<int> delta(Size);
+      std::vector<int> plus(Size);
+      std::vector<int> minus(Size);
+
+      for (int i = 0; i < Size; i++) {
+
+         const Param & param = G_Param[i];
+
+         delta[i] = (rand() % 2 == 0) ? +1 : -1;
+
+         double d = step[i] * ck * delta[i];
+         plus[i]  = std::max(param.min, std::min(int(std::lround(theta[i] + d)), param.max));
+         minus[i] = std::max(param.min, std::min(int(std::lround(theta[i] - d)), param.max));
+      }
+
+      // match, both colours per opening
+
+      int score = 0; // for "plus"
+
+      for (int g = 0; g < games; g += 2) {
+
+         std::vector<Move> opening;
+         Pos pos = pos::Start;
+
+         for (int ply = 0; ply < Opening_Ply; ply++) {
+
+            List list;
+            gen_moves(list, pos);
+            if (list.size() == 0) break;
+
+            Move mv = list[int(rand() % uint64(list.size()))];
+            opening.push_back(mv);
+            pos = pos.succ(mv);
+         }
+
+         score += play_game(plus, minus, opening, nodes);
+         score -= play_game(minus, plus, opening, nodes);
+      }
+
+      // gradient step
+
+      double result = double(score) / double(std::max(games, 1)); // [-1, +1]
+
+      for (int i = 0; i < Size; i++) {
+         const Param & param = G_Param[i];
+         theta[i] += ak * step[i] * result * delta[i]; // at most one step
+         theta[i] = std::max(double(param.min), std::min(theta[i], double(param.max)));
+      }
+
+      std::cout << "iteration " << k << "/" << iterations << ": score " << ml::ftos(result, 3) << std::endl;
+
+      for (int i = 0; i < Size; i++) {
+         std::cout << "   " << setting(G_Param[i]) << " = " << ml::ftos(theta[i], 2) << std::endl;
+      }
+   }
+
+   // final values in INI format
+
+   std::cout << std::endl;
+   std::cout << "# " << var::get("variant") << std::endl;
+
+   for (int i = 0; i < Size; i++) {
+      std::cout << setting(G_Param[i]) << " = " << std::lround(theta[i]) << std::endl;
+   }
+}
+
+static void apply(const std::vector<int> & values) {
+
+   for (int i = 0; i < Size; i++) {
+      var::set(setting(G_Param[i]), std::to_string(values[i])); // search() calls update()
+   }
+}
+
+static int play_game(const std::vector<int> & white, const std::vector<int> & black, const std::vector<Move> & opening, int64 nodes) {
+
+   Game game;
+
+   for (Move mv : opening) {
+      game.add_move(mv);
+   }
+
+   while (!game.is_end(var::BB) && game.ply() < Game_Ply_Max) {
+
+      apply((game.turn() == White) ? white : black);
+      G_TT.clear(); // the engines don't share knowledge
+
+      Search_Input si;
+      si.move = true;
+      si.book = false;
+      si.nodes = nodes;
+      si.output = Output_None;
+
+      Search_Output so;
+      search(so, game.node(), si);
+
+      Move mv = so.move;
+      if (mv == move::None) mv = quick_move(game.node());
+
+      game.add_move(mv);
+   }
+
+   if (!game.is_end(var::BB)) return 0; // draw by adjudication
+
+   return game.result(var::BB, White);
+}
+
+#else
+
+void spsa(int /* iterations */, int /* games */, int64 /* nodes */) {
+   std::cerr << "SPSA needs a tuning build (make TUNE=1)" << std::endl;
+   std::exit(EXIT_FAILURE);
+}
+
+#endif
+
+} // namespace tune
+
@@ -0,0 +1,54 @@
+
+#ifndef TUNE_HPP
+#define TUNE_HPP
+
+// includes
+
+#include "common.hpp"
+#include "libmy.hpp"
+
+// macros
+
+// search parameters: name, default, min, max
+
+#define TUNE_PARAMS(P) \
+   P(LMR_Depth,          2,   1,   6) \
+   P(LMR_Moves_PV,       3,   1,  10) \
+   P(LMR_Moves,          1,   1,  10) \
+   P(LMR_Moves_2,        4,   1,  20) \
+   P(Prune_Depth,        3,   1,   8) \
+   P(Prune_Margin,      10,   0,  40) \
+   P(Prune_Red,         40,  10,  90) \
+   P(Sing_Depth,         8,   4,  16) \
+   P(Sing_Margin,       40,   0, 200) \
+   P(Sing_Red,           4,   1,   8) \
+   P(Asp_Margin_Normal, 10,   2,  60) \
+   P(Asp_Margin,        20,   2,  60) \
+   P(SMP_Depth,          6,   2,  16) \
+   P(SMP_Moves,          5,   1,  20)
+
+// constexpr in normal builds, settings in tuning builds ("make TUNE=1")
+
+#ifdef TUNE
+#define TUNE_DECLARE(name, value, min, max) extern int name;
+#else
+#define TUNE_DECLARE(name, value, min, max) constexpr int name {value};
+#endif
+
+namespace tune {
+
+// "constants"
+
+TUNE_PARAMS(TUNE_DECLARE)
+
+// functions
+
+void init   (); // before var::load()
+void update ();
+
+void spsa (int iterations, int games, int64 nodes);
+
+} // namespace tune
+
+#endif // !defined TUNE_HPP
+
@@ -19,12 +19,17 @@ Variant_Type Variant;
 bool Book;
 int  Book_Ply;
 int  Book_Margin;
+bool Book_Canonical;
 bool Ponder;
 bool SMP;
 int  Threads;
 int  TT_Size;
 bool BB;
 int  BB_Size;
+int  BB_Flat;
+bool BB_Lazy;
+std::string Time_Trace;
+std::string BB_Usage;
 
 bool DXP_Server;
 std::string DXP_Host;
@@ -35,6 +40,10 @@ int  DXP_Moves;
 bool DXP_Board;
 bool DXP_Search;
 
+int  Cluster_Workers;
+std::string Cluster_Host;
+int  Cluster_Port;
+
 static std::map<std::string, std::string> Var;
 
 // prototypes
@@ -50,10 +59,15 @@ void init() {
    set("book", "true");
    set("book-ply", "4");
    set("book-margin", "4");
+   set("book-canonical", "false");
    set("ponder", "false");
    set("threads", "1");
    set("tt-size", "24");
    set("bb-size", "5");
+   set("bb-flat", "16"); // MB of fully decoded slices
+   set("bb-lazy", "false"); // load shards on demand, the search doesn't wait for them
+   set("time-trace", ""); // file name, see "scan time-sim"
+   set("bb-usage", ""); // file name, probes per slice, see "scan bb-pack"
 
    set("dxp-server", "true");
    set("dxp-host", "127.0.0.1");
@@ -64,6 +78,10 @@ void init() {
    set("dxp-board", "false");
    set("dxp-search", "false");
 
+   set("cluster-workers", "0");
+   set("cluster-host", "127.0.0.1");
+   set("cluster-port", "27532");
+
    update();
 }
 
@@ -136,15 +154,20 @@ void update() {
       std::exit(EXIT_FAILURE);
    }
 
-   Book        = get_bool("book");
-   Book_Ply    = get_int("book-ply");
-   Book_Margin = get_int("book-margin");
-   Ponder      = get_bool("ponder");
-   Threads     = get_int("threads");
-   SMP         = Threads > 1;
-   TT_Size     = 1 << get_int("tt-size");
-   BB_Size     = get_int("bb-size");
-   BB          = BB_Size > 0;
+   Book           = get_bool("book");
+   Book_Ply       = get_int("book-ply");
+   Book_Margin    = get_int("book-margin");
+   Book_Canonical = get_bool("book-canonical");
+   Ponder         = get_bool("ponder");
+   Threads        = get_int("threads");
+   SMP            = Threads > 1 || get_int("cluster-workers") > 0; // remote workers run in local threads
+   TT_Size        = 1 << get_int("tt-size");
+   BB_Size        = get_int("bb-size");
+   BB             = BB_Size > 0;
+   BB_Flat        = get_int("bb-flat");
+   BB_Lazy        = get_bool("bb-lazy");
+   Time_Trace     = get("time-trace");
+   BB_Usage       = get("bb-usage");
 
    DXP_Server    = get_bool("dxp-server");
    DXP_Host      = get("dxp-host");
@@ -154,6 +177,10 @@ void update() {
    DXP_Moves     = get_int("dxp-moves");
    DXP_Board     = get_bool("dxp-board");
    DXP_Search    = get_bool("dxp-search");
+
+   Cluster_Workers = get_int("cluster-workers");
+   Cluster_Host    = get("cluster-host");
+   Cluster_Port    = get_int("cluster-port");
 }
 
 std::string get(const std::string & name) {
@@ -20,12 +20,17 @@ extern Variant_Type Variant;
 extern bool Book;
 extern int  Book_Ply;
 extern int  Book_Margin;
+extern bool Book_Canonical;
 extern bool Ponder;
 extern bool SMP;
 extern int  Threads;
 extern int  TT_Size;
 extern bool BB;
 extern int  BB_Size;
+extern int  BB_Flat;
+extern bool BB_Lazy;
+extern std::string Time_Trace;
+extern std::string BB_Usage;
 
 extern bool DXP_Server;
 extern std::string DXP_Host;
@@ -36,6 +41,10 @@ extern int  DXP_Moves;
 extern bool DXP_Board;
 extern bool DXP_Search;
 
+extern int  Cluster_Workers;
+extern std::string Cluster_Host;
+extern int  Cluster_Port;
+
 // functions
 
 void init   ();